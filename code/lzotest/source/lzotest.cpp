@@ -0,0 +1,480 @@
+/*
+    MANGO Multimedia Development Platform
+    Copyright (C) 2012-2025 Twilight Finland 3D Oy Ltd. All rights reserved.
+*/
+#include <mango/mango.hpp>
+#include "mango_compress_lzo.hpp"
+
+using namespace mango;
+
+// ----------------------------------------------------------------------------
+// corpus
+// ----------------------------------------------------------------------------
+
+struct Sample
+{
+    std::string name;
+    std::vector<u8> data;
+};
+
+// Deterministic data with different redundancy; used when no files are given.
+std::vector<Sample> generateCorpus(size_t size)
+{
+    std::vector<Sample> corpus;
+
+    u32 seed = 0x2545f491;
+    auto random = [&seed] ()
+    {
+        // xorshift32
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return seed;
+    };
+
+    // words with skewed frequencies
+    {
+        const char* words [] =
+        {
+            "the", "of", "and", "to", "in", "is", "compression", "block", "stream",
+            "decoder", "literal", "match", "offset", "length", "buffer", "window",
+            "entropy", "huffman", "dictionary", "throughput", "latency", "image",
+        };
+        constexpr int count = sizeof(words) / sizeof(words[0]);
+
+        std::string text;
+        while (text.size() < size)
+        {
+            u32 r = random();
+            int index = int((r & 0xff) * (r & 0xff) / (256 * 256 / count)) % count;
+            text += words[index];
+            text += (r >> 24) < 16 ? ".\n" : " ";
+        }
+
+        corpus.push_back({ "text", std::vector<u8>(text.begin(), text.begin() + size) });
+    }
+
+    // fixed size records with slowly changing fields
+    {
+        std::vector<u8> data(size);
+        u32 time = 1700000000;
+        float value = 20.0f;
+
+        for (size_t i = 0; i + 16 <= size; i += 16)
+        {
+            u32 r = random();
+            time += 1 + (r & 3);
+            value += float(int(r >> 28) - 7) * 0.125f;
+            littleEndian::ustore32(&data[i + 0], u32(i / 16));
+            littleEndian::ustore32(&data[i + 4], time);
+            std::memcpy(&data[i + 8], &value, 4);
+            littleEndian::ustore16(&data[i + 12], u16((r >> 8) & 0x0101));
+            littleEndian::ustore16(&data[i + 14], 0);
+        }
+
+        corpus.push_back({ "records", std::move(data) });
+    }
+
+    // mostly zeros
+    {
+        std::vector<u8> data(size, 0);
+        for (size_t i = 0; i < size; ++i)
+        {
+            u32 r = random();
+            if ((r & 63) == 0)
+            {
+                data[i] = u8(r >> 24);
+            }
+        }
+
+        corpus.push_back({ "sparse", std::move(data) });
+    }
+
+    // incompressible
+    {
+        std::vector<u8> data(size);
+        for (size_t i = 0; i < size; ++i)
+        {
+            data[i] = u8(random() >> 24);
+        }
+
+        corpus.push_back({ "random", std::move(data) });
+    }
+
+    return corpus;
+}
+
+// ----------------------------------------------------------------------------
+// codecs
+// ----------------------------------------------------------------------------
+
+size_t exact_bound(size_t size)
+{
+    return size;
+}
+
+struct Codec
+{
+    std::string name;
+    int level;
+    size_t (*bound)(size_t size);
+    CompressionStatus (*compress)(Memory dest, ConstMemory source, int level);
+    CompressionStatus (*decompress)(Memory dest, ConstMemory source);
+    size_t (*decompress_bound)(size_t size); // destination size for decompress
+};
+
+std::vector<Codec> getCodecs()
+{
+    std::vector<Codec> codecs;
+
+    // the new decoder against the minilzo one in mango; lzo has one level
+    codecs.push_back({ "lzo", 0, extra::lzo::bound, extra::lzo::compress, extra::lzo::decompress, extra::lzo::decompress_bound });
+
+    codecs.push_back({ "lzo (mango)", 0,
+        [] (size_t size) { return lzo::bound(size); },
+        [] (Memory dest, ConstMemory source, int level) { return lzo::compress(dest, source, level); },
+        [] (Memory dest, ConstMemory source) { return lzo::decompress(dest, source); },
+        exact_bound });
+
+    for (int level = 0; level <= 10; ++level)
+    {
+        codecs.push_back({ "lz4", level,
+            [] (size_t size) { return lz4::bound(size); },
+            [] (Memory dest, ConstMemory source, int level) { return lz4::compress(dest, source, level); },
+            [] (Memory dest, ConstMemory source) { return lz4::decompress(dest, source); },
+            exact_bound });
+    }
+
+    for (int level = 0; level <= 10; ++level)
+    {
+        codecs.push_back({ "zstd", level,
+            [] (size_t size) { return zstd::bound(size); },
+            [] (Memory dest, ConstMemory source, int level) { return zstd::compress(dest, source, level); },
+            [] (Memory dest, ConstMemory source) { return zstd::decompress(dest, source); },
+            exact_bound });
+    }
+
+    return codecs;
+}
+
+// ----------------------------------------------------------------------------
+// benchmark
+// ----------------------------------------------------------------------------
+
+struct Result
+{
+    u64 bytes = 0;
+    u64 compressed = 0;
+    u64 compress_us = 0;
+    u64 decompress_us = 0;
+
+    // the same data compressed one small block at a time
+    u64 blocks = 0;
+    u64 block_compress_us = 0;
+    u64 block_decompress_us = 0;
+
+    bool passed = true;
+};
+
+u64 median(std::vector<u64> values)
+{
+    std::sort(values.begin(), values.end());
+    size_t n = values.size() / 2;
+    return (values.size() & 1) ? values[n] : (values[n - 1] + values[n]) / 2;
+}
+
+double getMBps(u64 bytes, u64 us)
+{
+    return us ? double(bytes) / double(us) : 0.0;
+}
+
+std::vector<ConstMemory> getBlocks(ConstMemory memory, size_t block_size)
+{
+    std::vector<ConstMemory> blocks;
+
+    for (size_t offset = 0; offset < memory.size; offset += block_size)
+    {
+        blocks.emplace_back(memory.address + offset, std::min(block_size, memory.size - offset));
+    }
+
+    return blocks;
+}
+
+Result bench(const Codec& codec, const std::vector<Sample>& corpus, size_t block_size, int repeat)
+{
+    Result result;
+
+    for (const Sample& sample : corpus)
+    {
+        ConstMemory source(sample.data.data(), sample.data.size());
+
+        std::vector<u8> compressed(codec.bound(source.size));
+        std::vector<u8> decompressed(codec.decompress_bound(source.size));
+
+        std::vector<u64> compress_time;
+        std::vector<u64> decompress_time;
+        size_t size = 0;
+
+        for (int i = 0; i < repeat; ++i)
+        {
+            u64 time0 = Time::us();
+
+            CompressionStatus cs = codec.compress(Memory(compressed.data(), compressed.size()), source, codec.level);
+
+            u64 time1 = Time::us();
+
+            CompressionStatus ds = codec.decompress(Memory(decompressed.data(), decompressed.size()), ConstMemory(compressed.data(), cs.size));
+
+            u64 time2 = Time::us();
+
+            compress_time.push_back(time1 - time0);
+            decompress_time.push_back(time2 - time1);
+
+            size = cs.size;
+            result.passed = result.passed && cs && ds && ds.size == source.size &&
+                            !std::memcmp(decompressed.data(), source.address, source.size);
+        }
+
+        result.bytes += source.size;
+        result.compressed += size;
+        result.compress_us += median(compress_time);
+        result.decompress_us += median(decompress_time);
+
+        // small blocks: the fixed cost per call dominates. A single call takes about a
+        // microsecond, so the whole loop is timed and divided by the block count.
+        std::vector<ConstMemory> blocks = getBlocks(source, block_size);
+
+        const size_t block_bound = codec.bound(block_size);
+        std::vector<u8> block_compressed(blocks.size() * block_bound);
+        std::vector<size_t> block_sizes(blocks.size());
+
+        // the blocks decode back to back; the slack of the last block goes past the end
+        std::vector<u8> block_decompressed(codec.decompress_bound(source.size));
+
+        compress_time.clear();
+        decompress_time.clear();
+
+        bool passed = true;
+
+        for (int i = 0; i < repeat; ++i)
+        {
+            u64 time0 = Time::us();
+
+            for (size_t j = 0; j < blocks.size(); ++j)
+            {
+                Memory dest(block_compressed.data() + j * block_bound, block_bound);
+                CompressionStatus cs = codec.compress(dest, blocks[j], codec.level);
+                block_sizes[j] = cs ? cs.size : 0;
+            }
+
+            u64 time1 = Time::us();
+
+            for (size_t j = 0; j < blocks.size(); ++j)
+            {
+                size_t offset = j * block_size;
+                Memory dest(block_decompressed.data() + offset, codec.decompress_bound(blocks[j].size));
+                CompressionStatus ds = codec.decompress(dest, ConstMemory(block_compressed.data() + j * block_bound, block_sizes[j]));
+                passed = passed && ds && ds.size == blocks[j].size;
+            }
+
+            u64 time2 = Time::us();
+
+            compress_time.push_back(time1 - time0);
+            decompress_time.push_back(time2 - time1);
+
+            // verified outside of the timed loops
+            passed = passed && !std::memcmp(block_decompressed.data(), source.address, source.size);
+            std::fill(block_decompressed.begin(), block_decompressed.end(), 0);
+        }
+
+        result.passed = result.passed && passed;
+        result.blocks += blocks.size();
+        result.block_compress_us += median(compress_time);
+        result.block_decompress_us += median(decompress_time);
+    }
+
+    return result;
+}
+
+// All blocks of the corpus compressed with one extra::lzo::compress_batch() call and
+// decompressed one by one into one output; the whole buffer numbers are for the
+// blocks as well.
+Result bench_batch(const std::vector<Sample>& corpus, size_t block_size, int repeat)
+{
+    Result result;
+
+    std::vector<ConstMemory> blocks;
+    for (const Sample& sample : corpus)
+    {
+        std::vector<ConstMemory> b = getBlocks(ConstMemory(sample.data.data(), sample.data.size()), block_size);
+        blocks.insert(blocks.end(), b.begin(), b.end());
+        result.bytes += sample.data.size();
+    }
+
+    // the blocks decode back to back; the slack of the last block goes past the end
+    std::vector<u8> decompressed(extra::lzo::decompress_bound(result.bytes));
+
+    std::vector<u64> compress_time;
+    std::vector<u64> decompress_time;
+
+    extra::lzo::Batch batch;
+
+    for (int i = 0; i < repeat; ++i)
+    {
+        u64 time0 = Time::us();
+
+        CompressionStatus cs = extra::lzo::compress_batch(batch, blocks, true);
+
+        u64 time1 = Time::us();
+
+        result.passed = result.passed && cs;
+
+        bool passed = true;
+        size_t offset = 0;
+
+        for (size_t j = 0; j < blocks.size() && cs; ++j)
+        {
+            ConstMemory input(batch.arena.data() + batch.offsets[j], batch.offsets[j + 1] - batch.offsets[j]);
+            Memory dest(decompressed.data() + offset, extra::lzo::decompress_bound(blocks[j].size));
+            CompressionStatus ds = extra::lzo::decompress(dest, input);
+
+            passed = passed && ds && ds.size == blocks[j].size;
+            offset += blocks[j].size;
+        }
+
+        u64 time2 = Time::us();
+
+        compress_time.push_back(time1 - time0);
+        decompress_time.push_back(time2 - time1);
+
+        // verified outside of the timed loop
+        offset = 0;
+
+        for (size_t j = 0; j < blocks.size() && cs; ++j)
+        {
+            passed = passed && !std::memcmp(decompressed.data() + offset, blocks[j].address, blocks[j].size);
+            offset += blocks[j].size;
+        }
+
+        result.passed = result.passed && passed;
+        std::fill(decompressed.begin(), decompressed.end(), 0);
+    }
+
+    result.compressed = batch.arena.size();
+    result.compress_us = median(compress_time);
+    result.decompress_us = median(decompress_time);
+    result.blocks = blocks.size();
+    result.block_compress_us = result.compress_us;
+    result.block_decompress_us = result.decompress_us;
+
+    return result;
+}
+
+void printResult(const std::string& name, int level, const Result& result, bool json)
+{
+    double ratio = result.bytes ? double(result.compressed) / double(result.bytes) : 0.0;
+    double block_compress = result.blocks ? double(result.block_compress_us) / double(result.blocks) : 0.0;
+    double block_decompress = result.blocks ? double(result.block_decompress_us) / double(result.blocks) : 0.0;
+
+    const char* status = result.passed ? "PASSED" : "FAILED";
+
+    if (json)
+    {
+        printLine("{{ \"codec\": \"{}\", \"level\": {}, \"size\": {}, \"compressed\": {}, "
+                  "\"compress_mbps\": {:.1f}, \"decompress_mbps\": {:.1f}, "
+                  "\"block_compress_us\": {:.2f}, \"block_decompress_us\": {:.2f}, \"status\": \"{}\" }}",
+            name, level, result.bytes, result.compressed,
+            getMBps(result.bytes, result.compress_us), getMBps(result.bytes, result.decompress_us),
+            block_compress, block_decompress, status);
+    }
+    else
+    {
+        printLine("{:<14} {:>5} {:>7.3f} {:>10.1f} {:>10.1f} {:>9.2f} {:>9.2f}  {}",
+            name, level, ratio,
+            getMBps(result.bytes, result.compress_us), getMBps(result.bytes, result.decompress_us),
+            block_compress, block_decompress, status);
+    }
+}
+
+int main(int argc, const char* argv[])
+{
+    int repeat = 5;
+    size_t block_size = 4096;
+    size_t size = 4 << 20;
+    bool json = false;
+
+    std::vector<std::string> filenames;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+
+        if (arg == "--repeat" && i + 1 < argc)
+        {
+            repeat = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--block" && i + 1 < argc)
+        {
+            block_size = size_t(std::max(1, std::atoi(argv[++i])));
+        }
+        else if (arg == "--size" && i + 1 < argc)
+        {
+            size = size_t(std::max(1, std::atoi(argv[++i]))) << 10;
+        }
+        else if (arg == "--json")
+        {
+            json = true;
+        }
+        else if (arg.size() > 1 && arg[0] == '-')
+        {
+            printLine("usage: lzotest [--repeat <count>] [--block <bytes>] [--size <KB>] [--json] [files...]");
+            printLine("       without files a generated corpus of four samples of <size> KB is used");
+            return 1;
+        }
+        else
+        {
+            filenames.push_back(arg);
+        }
+    }
+
+    std::vector<Sample> corpus;
+
+    if (filenames.empty())
+    {
+        corpus = generateCorpus(size);
+    }
+    else
+    {
+        for (const std::string& filename : filenames)
+        {
+            filesystem::File file(filename);
+            ConstMemory memory = file;
+
+            if (memory.size)
+            {
+                corpus.push_back({ filename, std::vector<u8>(memory.address, memory.address + memory.size) });
+            }
+        }
+    }
+
+    u64 bytes = 0;
+    for (const Sample& sample : corpus)
+    {
+        bytes += sample.data.size();
+    }
+
+    if (!json)
+    {
+        printLine("corpus: {} samples, {} KB, block: {} bytes, repeat: {}, median times", corpus.size(), bytes / 1024, block_size, repeat);
+        printLine("-------------------------------------------------------------------------------");
+        printLine("codec          level   ratio comp(MB/s)  dec(MB/s) blk c(us) blk d(us)");
+        printLine("-------------------------------------------------------------------------------");
+    }
+
+    for (const Codec& codec : getCodecs())
+    {
+        printResult(codec.name, codec.level, bench(codec, corpus, block_size, repeat), json);
+    }
+
+    printResult("lzo batch", 0, bench_batch(corpus, block_size, repeat), json);
+}
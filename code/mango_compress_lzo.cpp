@@ -1,11 +1,337 @@
-
+/*
+    MANGO Multimedia Development Platform
+    Copyright (C) 2012-2025 Twilight Finland 3D Oy Ltd. All rights reserved.
+*/
+#include <atomic>
+#include <thread>
 #include "lzo/minilzo.h"
+#include "mango_compress_lzo.hpp"
+
+// ----------------------------------------------------------------------------
+// lzo1x decoder
+// ----------------------------------------------------------------------------
+
+namespace
+{
+    using namespace mango;
+
+
+    // Literals are copied in 32 byte blocks and matches in 16 byte blocks (8 for short
+    // match distances), so a copy may write up to 31 bytes past its end and a literal
+    // copy reads as far past the end of the literals; LZO_WILDCOPY_SLACK covers the
+    // widest block. The blocks are used only when both buffers have that much room
+    // left; near the end the copies are exact. A destination with LZO_WILDCOPY_SLACK
+    // bytes more than the decompressed size stays on the fast path all the way, a
+    // tight one is still decoded correctly.
+    constexpr size_t LZO_WILDCOPY_SLACK = 32;
+
+    constexpr size_t LZO_M2_MAX_OFFSET = 0x0800;
+
+    inline void lzo_copy8(u8* dest, const u8* source)
+    {
+        std::memcpy(dest, source, 8);
+    }
+
+    inline void lzo_copy16(u8* dest, const u8* source)
+    {
+        std::memcpy(dest, source, 16);
+    }
+
+    inline void lzo_wildcopy_literals(u8* dest, const u8* source, size_t length)
+    {
+        u8* end = dest + length;
+        do
+        {
+            lzo_copy16(dest + 0, source + 0);
+            lzo_copy16(dest + 16, source + 16);
+            dest += 32;
+            source += 32;
+        } while (dest < end);
+    }
+
+    inline void lzo_wildcopy_match(u8* dest, const u8* match, size_t length)
+    {
+        u8* end = dest + length;
+        size_t offset = size_t(dest - match);
+
+        if (offset >= 16)
+        {
+            do
+            {
+                lzo_copy16(dest, match);
+                dest += 16;
+                match += 16;
+            } while (dest < end);
+        }
+        else
+        {
+            // spread short repeating patterns to a distance of at least 8 bytes
+            static const u32 inc[] = { 0, 1, 2, 1, 0, 4, 4, 4 };
+            static const int dec[] = { 0, 0, 0, -1, -4, 1, 2, 3 };
+
+            if (offset < 8)
+            {
+                dest[0] = match[0];
+                dest[1] = match[1];
+                dest[2] = match[2];
+                dest[3] = match[3];
+                match += inc[offset];
+                std::memcpy(dest + 4, match, 4);
+                match -= dec[offset];
+            }
+            else
+            {
+                lzo_copy8(dest, match);
+                match += 8;
+            }
+
+            dest += 8;
+
+            while (dest < end)
+            {
+                lzo_copy8(dest, match);
+                dest += 8;
+                match += 8;
+            }
+        }
+    }
+
+    // Extended length: each zero byte adds 255, the first non-zero byte ends the run.
+    inline bool lzo_read_length(const u8*& ip, const u8* ip_end, size_t& length, size_t base)
+    {
+        size_t zeros = 0;
+
+        for (;;)
+        {
+            if (ip >= ip_end)
+                return false;
+
+            u8 value = *ip++;
+            if (value)
+            {
+                length = base + zeros * 255 + value;
+                return true;
+            }
+
+            // guard against overflow on corrupted input
+            if (++zeros > (size_t(1) << 24))
+                return false;
+        }
+    }
+
+    // Decodes an LZO1X stream (all lzo1x compression levels produce the same format)
+    // and returns nullptr on success or the reason of failure. Every read and write is
+    // checked, so corrupted input never accesses memory outside the buffers.
+    const char* lzo1x_decode(Memory dest, ConstMemory source, size_t& written)
+    {
+        const u8* ip = source.address;
+        const u8* const ip_end = ip + source.size;
+
+        u8* op = dest.address;
+        u8* const op_begin = op;
+        u8* const op_end = op + dest.size;
+
+        // Number of literals after the previous instruction: 0 after a match, 1..3 after
+        // a match with trailing literals, 4 after a literal run. It decides what an
+        // instruction below 16 means.
+        int state = 0;
+
+        auto copy_literals = [&] (size_t length) -> const char*
+        {
+            if (length > size_t(ip_end - ip))
+                return "input overrun";
+
+            if (length > size_t(op_end - op))
+                return "output overrun";
+
+            if (size_t(ip_end - ip) >= length + LZO_WILDCOPY_SLACK &&
+                size_t(op_end - op) >= length + LZO_WILDCOPY_SLACK)
+            {
+                lzo_wildcopy_literals(op, ip, length);
+            }
+            else
+            {
+                std::memcpy(op, ip, length);
+            }
+
+            op += length;
+            ip += length;
+            return nullptr;
+        };
+
+        const char* error = nullptr;
+
+        if (ip < ip_end && *ip > 17)
+        {
+            // the stream starts with a literal run
+            size_t length = *ip++ - 17;
+            error = copy_literals(length);
+            state = length < 4 ? int(length) : 4;
+        }
+
+        while (!error)
+        {
+            if (ip >= ip_end)
+            {
+                error = "input overrun";
+                break;
+            }
+
+            size_t t = *ip++;
+            size_t distance;
+            size_t length;
+
+            if (t >= 64)
+            {
+                // M2: 3..8 bytes, distance up to 2 KB
+                if (ip >= ip_end)
+                {
+                    error = "input overrun";
+                    break;
+                }
+
+                distance = 1 + ((t >> 2) & 7) + (size_t(*ip++) << 3);
+                length = (t >> 5) + 1;
+            }
+            else if (t >= 32)
+            {
+                // M3: distance up to 16 KB
+                length = t & 31;
+                if (!length && !lzo_read_length(ip, ip_end, length, 31))
+                {
+                    error = "input overrun";
+                    break;
+                }
+
+                if (ip_end - ip < 2)
+                {
+                    error = "input overrun";
+                    break;
+                }
+
+                distance = 1 + (ip[0] >> 2) + (size_t(ip[1]) << 6);
+                length += 2;
+                ip += 2;
+            }
+            else if (t >= 16)
+            {
+                // M4: distance from 16 KB to 48 KB, distance 0 is the end of the stream
+                length = t & 7;
+                if (!length && !lzo_read_length(ip, ip_end, length, 7))
+                {
+                    error = "input overrun";
+                    break;
+                }
+
+                if (ip_end - ip < 2)
+                {
+                    error = "input overrun";
+                    break;
+                }
+
+                distance = ((t & 8) << 11) + (ip[0] >> 2) + (size_t(ip[1]) << 6);
+                ip += 2;
+
+                if (!distance)
+                {
+                    if (ip < ip_end)
+                        error = "input not consumed";
+                    break;
+                }
+
+                distance += 0x4000;
+                length += 2;
+            }
+            else if (!state)
+            {
+                // literal run
+                length = t;
+                if (!length && !lzo_read_length(ip, ip_end, length, 15))
+                {
+                    error = "input overrun";
+                    break;
+                }
+
+                error = copy_literals(length + 3);
+                state = 4;
+                continue;
+            }
+            else
+            {
+                // M1: short match after literals
+                if (ip >= ip_end)
+                {
+                    error = "input overrun";
+                    break;
+                }
+
+                distance = 1 + (t >> 2) + (size_t(*ip++) << 2);
+                length = 2;
+
+                if (state == 4)
+                {
+                    distance += LZO_M2_MAX_OFFSET;
+                    length = 3;
+                }
+            }
+
+            if (distance > size_t(op - op_begin))
+            {
+                error = "lookbehind overrun";
+                break;
+            }
+
+            if (length > size_t(op_end - op))
+            {
+                error = "output overrun";
+                break;
+            }
+
+            const u8* match = op - distance;
+
+            if (size_t(op_end - op) >= length + LZO_WILDCOPY_SLACK)
+            {
+                lzo_wildcopy_match(op, match, length);
+                op += length;
+            }
+            else
+            {
+                for (size_t i = 0; i < length; ++i)
+                {
+                    *op++ = *match++;
+                }
+            }
+
+            // the low bits of the instruction's second to last byte count trailing literals
+            state = ip[-2] & 3;
+
+            if (state)
+            {
+                if (size_t(ip_end - ip) >= 4 + LZO_WILDCOPY_SLACK &&
+                    size_t(op_end - op) >= 4 + LZO_WILDCOPY_SLACK)
+                {
+                    std::memcpy(op, ip, 4);
+                    op += state;
+                    ip += state;
+                }
+                else
+                {
+                    error = copy_literals(state);
+                }
+            }
+        }
+
+        written = size_t(op - op_begin);
+        return error;
+    }
+
+} // namespace
 
 // ----------------------------------------------------------------------------
 // lzo
 // ----------------------------------------------------------------------------
 
-namespace lzo
+namespace mango::extra::lzo
 {
 
     size_t bound(size_t size)
@@ -32,23 +358,163 @@ namespace lzo
 
         status.size = size_t(dst_len);
         return status;
-	}
+    }
+
+    size_t decompress_bound(size_t size)
+    {
+        return size + LZO_WILDCOPY_SLACK;
+    }
 
     CompressionStatus decompress(Memory dest, ConstMemory source)
     {
-        lzo_uint dst_len = (lzo_uint)dest.size;
-        int x = lzo1x_decompress(source.address, lzo_uint(source.size),
-            dest.address, &dst_len, nullptr);
+        CompressionStatus status;
+
+        size_t written = 0;
+        const char* error = lzo1x_decode(dest, source, written);
+        if (error)
+        {
+            status.setError(std::string("[lzo] decompression failed: ") + error + ".");
+        }
+
+        status.size = written;
+        return status;
+    }
+
+    // ------------------------------------------------------------------------
+    // batch
+    // ------------------------------------------------------------------------
+
+    // Work memory for lzo1x_1_compress(); allocated once per thread.
+    static u8* getWorkMemory()
+    {
+        thread_local std::vector<u8> work(LZO1X_MEM_COMPRESS);
+        return work.data();
+    }
+
+    // Input index ranges of roughly equal byte count; a few per core for load balancing
+    // but large enough that the scheduling overhead does not show with small messages.
+    static std::vector<size_t> getBatchChunks(std::span<const ConstMemory> sources, bool multithread)
+    {
+        constexpr u64 min_chunk_bytes = 256 * 1024;
+
+        u64 total = 0;
+        for (const ConstMemory& source : sources)
+        {
+            total += source.size;
+        }
+
+        u64 cores = multithread ? std::max(1u, std::thread::hardware_concurrency()) : 1;
+        u64 target = multithread ? std::max(total / (cores * 4), min_chunk_bytes) : total;
+
+        std::vector<size_t> bounds { 0 };
+        u64 bytes = 0;
+
+        for (size_t i = 0; i < sources.size(); ++i)
+        {
+            bytes += sources[i].size;
+            if (bytes >= target && multithread)
+            {
+                bounds.push_back(i + 1);
+                bytes = 0;
+            }
+        }
+
+        if (bounds.back() != sources.size())
+        {
+            bounds.push_back(sources.size());
+        }
+
+        return bounds;
+    }
+
+    CompressionStatus compress_batch(Batch& batch, std::span<const ConstMemory> sources, bool multithread)
+    {
+        std::vector<size_t> bounds = getBatchChunks(sources, multithread);
+        const size_t chunks = bounds.size() - 1;
+        const size_t count = sources.size();
+
+        // each chunk compresses into one worst case scratch buffer
+        std::vector<std::vector<u8>> scratch(chunks);
+        std::vector<size_t> sizes(count, 0);
+        std::atomic<bool> failed { false };
+
+        auto compress_chunk = [&] (size_t c)
+        {
+            size_t max_size = 0;
+            for (size_t i = bounds[c]; i < bounds[c + 1]; ++i)
+            {
+                max_size += bound(sources[i].size);
+            }
+
+            std::vector<u8>& buffer = scratch[c];
+            buffer.resize(max_size);
+
+            u8* work = getWorkMemory();
+            size_t offset = 0;
+
+            for (size_t i = bounds[c]; i < bounds[c + 1]; ++i)
+            {
+                lzo_uint dst_len = lzo_uint(max_size - offset);
+                int x = lzo1x_1_compress(sources[i].address, lzo_uint(sources[i].size),
+                    buffer.data() + offset, &dst_len, work);
+
+                if (x != LZO_E_OK)
+                {
+                    failed = true;
+                    break;
+                }
+
+                sizes[i] = size_t(dst_len);
+                offset += size_t(dst_len);
+            }
+
+            buffer.resize(offset);
+        };
+
+        if (chunks > 1)
+        {
+            ConcurrentQueue q;
+
+            for (size_t c = 0; c < chunks; ++c)
+            {
+                q.enqueue([&, c]
+                {
+                    compress_chunk(c);
+                });
+            }
+
+            q.wait();
+        }
+        else if (chunks == 1)
+        {
+            compress_chunk(0);
+        }
 
         CompressionStatus status;
 
-        if (x != LZO_E_OK)
+        if (failed)
+        {
+            status.setError("[lzo] compression failed.");
+            return status;
+        }
+
+        batch.offsets.resize(count + 1);
+        batch.offsets[0] = 0;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            batch.offsets[i + 1] = batch.offsets[i] + sizes[i];
+        }
+
+        batch.arena.resize(batch.offsets[count]);
+
+        for (size_t c = 0; c < chunks; ++c)
         {
-            status.setError("[lzo] decompression failed.");
+            std::memcpy(batch.arena.data() + batch.offsets[bounds[c]], scratch[c].data(), scratch[c].size());
         }
 
-        status.size = dest.size;
+        status.size = batch.arena.size();
         return status;
     }
 
-} // namespace lzo
+} // namespace mango::extra::lzo
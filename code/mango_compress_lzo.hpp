@@ -0,0 +1,45 @@
+/*
+    MANGO Multimedia Development Platform
+    Copyright (C) 2012-2025 Twilight Finland 3D Oy Ltd. All rights reserved.
+*/
+#pragma once
+
+#include <span>
+#include <vector>
+#include <mango/mango.hpp>
+
+// LZO1X compression with minilzo and a bounds checked decoder which copies in wide
+// blocks. The interface follows mango::lzo; it lives in its own namespace so that
+// both can be linked into the same program and compared.
+
+namespace mango::extra::lzo
+{
+
+    size_t bound(size_t size);
+
+    // level is ignored: lzo1x_1 has only one
+    CompressionStatus compress(Memory dest, ConstMemory source, int level = 6);
+
+    // Destination size which keeps decompress() on the wide copies to the end of the
+    // output; any size from the decompressed size up decodes correctly.
+    size_t decompress_bound(size_t size);
+
+    CompressionStatus decompress(Memory dest, ConstMemory source);
+
+    // Many small buffers compressed into one arena: output i is at
+    // arena[offsets[i]] .. arena[offsets[i + 1]] and decompresses on its own.
+    struct Batch
+    {
+        std::vector<u8> arena;
+        std::vector<size_t> offsets; // count + 1 entries
+    };
+
+    // The sources are split into chunks of similar byte count for the thread pool,
+    // each compressed into one scratch buffer and copied into the arena in order.
+    // The compressor work memory (LZO1X_MEM_COMPRESS) is thread_local: it is allocated
+    // the first time a thread compresses and reused after that, so the cost is paid
+    // once per pool thread and not per call or per buffer. The batch can be reused
+    // to keep its capacity.
+    CompressionStatus compress_batch(Batch& batch, std::span<const ConstMemory> sources, bool multithread = true);
+
+} // namespace mango::extra::lzo
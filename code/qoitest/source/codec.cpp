@@ -0,0 +1,311 @@
+/*
+    MANGO Multimedia Development Platform
+    Copyright (C) 2012-2025 Twilight Finland 3D Oy Ltd. All rights reserved.
+*/
+#include <cmath>
+#include "codec.hpp"
+#include "prefilter.hpp"
+#include "qoi.h"
+
+namespace
+{
+    using namespace mango;
+    using namespace mango::image;
+    using codec::Codec;
+
+    // The tiles are contiguous RGBA: stride is width * 4
+
+    size_t getBytes(const Surface& tile)
+    {
+        return size_t(tile.width) * tile.height * 4;
+    }
+
+    // ----------------------------------------------------------------------------
+    // qoi
+    // ----------------------------------------------------------------------------
+
+    void encode_qoi(std::vector<u8>& output, const Surface& tile)
+    {
+        size_t length;
+        u8* data = qoi_encode(tile.image, tile.stride, tile.width, tile.height, &length);
+        output.assign(data, data + length);
+        delete[] data;
+    }
+
+    void decode_qoi(const Surface& tile, ConstMemory input)
+    {
+        qoi_decode(tile.image, input.address, input.size, tile.width, tile.height, tile.stride);
+    }
+
+    // ----------------------------------------------------------------------------
+    // qoi + zstd
+    // ----------------------------------------------------------------------------
+
+    // the QOI length is stored in front of the zstd data
+
+    void encode_qoi_zstd(std::vector<u8>& output, const Surface& tile)
+    {
+        size_t length;
+        u8* data = qoi_encode(tile.image, tile.stride, tile.width, tile.height, &length);
+
+        output.resize(4 + zstd::bound(length));
+        littleEndian::ustore32(output.data(), u32(length));
+        size_t size = zstd::compress(Memory(output.data() + 4, output.size() - 4), ConstMemory(data, length), 2);
+        output.resize(4 + size);
+
+        delete[] data;
+    }
+
+    void decode_qoi_zstd(const Surface& tile, ConstMemory input)
+    {
+        Buffer temp(littleEndian::uload32(input.address));
+        zstd::decompress(temp, ConstMemory(input.address + 4, input.size - 4));
+        qoi_decode(tile.image, temp.data(), temp.size(), tile.width, tile.height, tile.stride);
+    }
+
+    // ----------------------------------------------------------------------------
+    // lz4, zstd
+    // ----------------------------------------------------------------------------
+
+    void encode_lz4(std::vector<u8>& output, const Surface& tile)
+    {
+        ConstMemory memory(tile.image, getBytes(tile));
+        output.resize(lz4::bound(memory.size));
+        size_t size = lz4::compress(Memory(output.data(), output.size()), memory, 6);
+        output.resize(size);
+    }
+
+    void decode_lz4(const Surface& tile, ConstMemory input)
+    {
+        lz4::decompress(Memory(tile.image, getBytes(tile)), input);
+    }
+
+    void encode_zstd(std::vector<u8>& output, const Surface& tile)
+    {
+        ConstMemory memory(tile.image, getBytes(tile));
+        output.resize(zstd::bound(memory.size));
+        size_t size = zstd::compress(Memory(output.data(), output.size()), memory, 2);
+        output.resize(size);
+    }
+
+    void decode_zstd(const Surface& tile, ConstMemory input)
+    {
+        zstd::decompress(Memory(tile.image, getBytes(tile)), input);
+    }
+
+    // ----------------------------------------------------------------------------
+    // prefilter + lz4, zstd
+    // ----------------------------------------------------------------------------
+
+    void encode_shuffle_lz4(std::vector<u8>& output, const Surface& tile)
+    {
+        const size_t count = size_t(tile.width) * tile.height;
+        Buffer filtered(count * 4);
+        prefilter::encode(filtered.data(), tile.image, count, false);
+
+        output.resize(lz4::bound(filtered.size()));
+        size_t size = lz4::compress(Memory(output.data(), output.size()), filtered, 6);
+        output.resize(size);
+    }
+
+    void decode_shuffle_lz4(const Surface& tile, ConstMemory input)
+    {
+        const size_t count = size_t(tile.width) * tile.height;
+        Buffer temp(count * 4);
+        lz4::decompress(temp, input);
+        prefilter::decode(tile.image, temp.data(), count, false);
+    }
+
+    void encode_delta_zstd(std::vector<u8>& output, const Surface& tile)
+    {
+        const size_t count = size_t(tile.width) * tile.height;
+        Buffer filtered(count * 4);
+        prefilter::encode(filtered.data(), tile.image, count, true);
+
+        output.resize(zstd::bound(filtered.size()));
+        size_t size = zstd::compress(Memory(output.data(), output.size()), filtered, 2);
+        output.resize(size);
+    }
+
+    void decode_delta_zstd(const Surface& tile, ConstMemory input)
+    {
+        const size_t count = size_t(tile.width) * tile.height;
+        Buffer temp(count * 4);
+        zstd::decompress(temp, input);
+        prefilter::decode(tile.image, temp.data(), count, true);
+    }
+
+    // ----------------------------------------------------------------------------
+    // png
+    // ----------------------------------------------------------------------------
+
+    void encode_png(std::vector<u8>& output, const Surface& tile)
+    {
+        MemoryStream stream;
+        ImageEncoder encoder(".png");
+        encoder.encode(stream, tile, ImageEncodeOptions());
+
+        ConstMemory memory = stream;
+        output.assign(memory.address, memory.address + memory.size);
+    }
+
+    void decode_png(const Surface& tile, ConstMemory input)
+    {
+        ImageDecoder decoder(input, ".png");
+        decoder.decode(tile);
+    }
+
+    // ----------------------------------------------------------------------------
+    // candidates
+    // ----------------------------------------------------------------------------
+
+    struct Candidate
+    {
+        Codec codec;
+        const char* name;
+        void (*encode)(std::vector<u8>& output, const Surface& tile);
+        void (*decode)(const Surface& tile, ConstMemory input);
+    };
+
+    const Candidate g_candidates[] =
+    {
+        { Codec::QOI,         "qoi",       encode_qoi,         decode_qoi },
+        { Codec::QOI_ZSTD,    "qoi+zstd",  encode_qoi_zstd,    decode_qoi_zstd },
+        { Codec::LZ4,         "lz4",       encode_lz4,         decode_lz4 },
+        { Codec::ZSTD,        "zstd",      encode_zstd,        decode_zstd },
+        { Codec::SHUFFLE_LZ4, "shuf+lz4",  encode_shuffle_lz4, decode_shuffle_lz4 },
+        { Codec::DELTA_ZSTD,  "dlt+zstd",  encode_delta_zstd,  decode_delta_zstd },
+        { Codec::PNG,         "png",       encode_png,         decode_png },
+    };
+
+} // namespace
+
+namespace codec
+{
+    using namespace mango;
+    using namespace mango::image;
+
+    const char* getName(Codec codec)
+    {
+        for (const Candidate& candidate : g_candidates)
+        {
+            if (candidate.codec == codec)
+                return candidate.name;
+        }
+        return "unknown";
+    }
+
+    std::vector<Estimate> estimate(const Surface& surface, int tiles, int tile_size)
+    {
+        std::vector<Estimate> estimates;
+
+        if (surface.width <= 0 || surface.height <= 0 || tiles <= 0 || tile_size <= 0)
+        {
+            return estimates;
+        }
+
+        const int width = std::min(tile_size, surface.width);
+        const int height = std::min(tile_size, surface.height);
+
+        if (width == surface.width && height == surface.height)
+        {
+            // the whole image is one tile
+            tiles = 1;
+        }
+
+        // grid with roughly square cells, one tile at the center of each cell
+        const int columns = std::clamp(int(std::lround(std::sqrt(double(tiles) * surface.width / surface.height))), 1, tiles);
+        const int rows = div_ceil(tiles, columns);
+
+        // the tiles are stacked vertically into one contiguous RGBA bitmap
+        Bitmap source(width, height * tiles, Format(32, Format::UNORM, Format::RGBA, 8, 8, 8, 8));
+        Bitmap temp(width, height, Format(32, Format::UNORM, Format::RGBA, 8, 8, 8, 8));
+
+        for (int i = 0; i < tiles; ++i)
+        {
+            int column = i % columns;
+            int row = i / columns;
+            int x = (surface.width - width) * (column * 2 + 1) / (columns * 2);
+            int y = (surface.height - height) * (row * 2 + 1) / (rows * 2);
+            source.blit(0, i * height, Surface(surface, x, y, width, height));
+        }
+
+        const double bytes = double(getBytes(temp)) * tiles;
+        std::vector<std::vector<u8>> outputs(tiles);
+
+        for (const Candidate& candidate : g_candidates)
+        {
+            u64 time0 = Time::us();
+
+            for (int i = 0; i < tiles; ++i)
+            {
+                candidate.encode(outputs[i], Surface(source, 0, i * height, width, height));
+            }
+
+            u64 time1 = Time::us();
+
+            for (int i = 0; i < tiles; ++i)
+            {
+                candidate.decode(temp, ConstMemory(outputs[i].data(), outputs[i].size()));
+            }
+
+            u64 time2 = Time::us();
+
+            size_t compressed = 0;
+            for (const auto& output : outputs)
+            {
+                compressed += output.size();
+            }
+
+            Estimate result;
+            result.codec = candidate.codec;
+            result.ratio = compressed / bytes;
+            result.encode_mbps = bytes / std::max(time1 - time0, u64(1));
+            result.decode_mbps = bytes / std::max(time2 - time1, u64(1));
+            estimates.push_back(result);
+        }
+
+        return estimates;
+    }
+
+    Estimate select(const std::vector<Estimate>& estimates, const Target& target)
+    {
+        const Estimate* best = nullptr;
+
+        for (const Estimate& estimate : estimates)
+        {
+            bool accept = estimate.decode_mbps >= target.min_decode_mbps &&
+                          estimate.encode_mbps >= target.min_encode_mbps &&
+                          (target.max_ratio <= 0.0 || estimate.ratio <= target.max_ratio);
+
+            if (accept && (!best || estimate.ratio < best->ratio))
+            {
+                best = &estimate;
+            }
+        }
+
+        if (!best)
+        {
+            for (const Estimate& estimate : estimates)
+            {
+                if (!best || estimate.decode_mbps > best->decode_mbps)
+                {
+                    best = &estimate;
+                }
+            }
+        }
+
+        if (!best)
+        {
+            MANGO_EXCEPTION("[codec] No estimates to select from.");
+        }
+
+        return *best;
+    }
+
+    Estimate select(const Surface& surface, const Target& target)
+    {
+        return select(estimate(surface), target);
+    }
+
+} // namespace codec
@@ -0,0 +1,55 @@
+/*
+    MANGO Multimedia Development Platform
+    Copyright (C) 2012-2025 Twilight Finland 3D Oy Ltd. All rights reserved.
+*/
+#pragma once
+
+#include <vector>
+#include <mango/mango.hpp>
+
+namespace codec
+{
+    using mango::image::Surface;
+
+    // Lossless codecs for RGBA images
+    enum class Codec
+    {
+        QOI,
+        QOI_ZSTD,
+        LZ4,
+        ZSTD,
+        SHUFFLE_LZ4,  // plane split, then lz4
+        DELTA_ZSTD,   // plane split with delta, then zstd
+        PNG,
+    };
+
+    const char* getName(Codec codec);
+
+    struct Estimate
+    {
+        Codec codec;
+        double ratio;        // compressed size / uncompressed size
+        double encode_mbps;  // uncompressed MB/s
+        double decode_mbps;  // uncompressed MB/s
+    };
+
+    // Requirements for select(); zero disables the constraint.
+    struct Target
+    {
+        double min_decode_mbps = 0.0;
+        double min_encode_mbps = 0.0;
+        double max_ratio = 0.0;
+    };
+
+    // Compresses tiles sampled evenly across the surface with every codec and
+    // extrapolates the ratio and throughput from them. The tiles cover only a small
+    // part of a large image so the estimates are cheap but noisy; timings are measured
+    // on the calling thread.
+    std::vector<Estimate> estimate(const Surface& surface, int tiles = 8, int tile_size = 128);
+
+    // Returns the estimate with the best ratio among the codecs meeting the target or,
+    // when none does, the one with the fastest decoding.
+    Estimate select(const std::vector<Estimate>& estimates, const Target& target);
+    Estimate select(const Surface& surface, const Target& target);
+
+} // namespace codec
@@ -0,0 +1,361 @@
+/*
+    MANGO Multimedia Development Platform
+    Copyright (C) 2012-2025 Twilight Finland 3D Oy Ltd. All rights reserved.
+*/
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <new>
+#include "instrument.hpp"
+#include "rss.hpp"
+
+#if defined(MANGO_PLATFORM_LINUX)
+    #include <linux/perf_event.h>
+    #include <sys/ioctl.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+#if defined(__has_feature)
+    #if __has_feature(address_sanitizer) || __has_feature(memory_sanitizer) || __has_feature(thread_sanitizer)
+        #define INSTRUMENT_SANITIZER
+    #endif
+#endif
+
+#if defined(__SANITIZE_ADDRESS__) || defined(__SANITIZE_THREAD__)
+    #define INSTRUMENT_SANITIZER
+#endif
+
+#if defined(__GLIBC__) && !defined(INSTRUMENT_SANITIZER)
+    // the sanitizers interpose malloc themselves
+    #define INSTRUMENT_MALLOC
+#endif
+
+using namespace mango;
+
+namespace
+{
+
+    // ----------------------------------------------------------------------------
+    // allocation counters
+    // ----------------------------------------------------------------------------
+
+    // zero initialized before any constructor runs so they are safe to use from
+    // allocations made during static initialization
+
+    std::atomic<u64> g_allocations { 0 };
+    std::atomic<u64> g_bytes { 0 };
+
+    inline void count(size_t size)
+    {
+        g_allocations.fetch_add(1, std::memory_order_relaxed);
+        g_bytes.fetch_add(size, std::memory_order_relaxed);
+    }
+
+    // ----------------------------------------------------------------------------
+    // hardware counters
+    // ----------------------------------------------------------------------------
+
+#if defined(MANGO_PLATFORM_LINUX)
+
+    // The counters are inherited by the threads which the calling thread creates after
+    // they were opened and read() sums the threads up. Inherited counters cannot be
+    // read as a group, so each one is a separate event.
+
+    class Counters
+    {
+    protected:
+        static constexpr int count = 3;
+        int m_fd[count] = { -1, -1, -1 };
+
+        static int open(u64 config)
+        {
+            perf_event_attr attr {};
+            attr.size = sizeof(attr);
+            attr.type = PERF_TYPE_HARDWARE;
+            attr.config = config;
+            attr.disabled = 1;
+            attr.inherit = 1;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+
+            // calling thread and its future children on any cpu
+            return int(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+        }
+
+    public:
+        Counters()
+        {
+            const u64 configs[] =
+            {
+                PERF_COUNT_HW_CPU_CYCLES,
+                PERF_COUNT_HW_INSTRUCTIONS,
+                PERF_COUNT_HW_CACHE_MISSES,
+            };
+
+            for (int i = 0; i < count; ++i)
+            {
+                m_fd[i] = open(configs[i]);
+                if (m_fd[i] == -1)
+                {
+                    // typically perf_event_paranoid, a container or a virtual machine
+                    // without a PMU; all or nothing
+                    close();
+                    break;
+                }
+            }
+        }
+
+        ~Counters()
+        {
+            close();
+        }
+
+        void close()
+        {
+            for (int& fd : m_fd)
+            {
+                if (fd != -1)
+                {
+                    ::close(fd);
+                    fd = -1;
+                }
+            }
+        }
+
+        bool valid() const
+        {
+            return m_fd[0] != -1;
+        }
+
+        void start()
+        {
+            if (valid())
+            {
+                for (int fd : m_fd)
+                {
+                    ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+                    ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+                }
+            }
+        }
+
+        bool stop(instrument::Sample& sample)
+        {
+            if (!valid())
+                return false;
+
+            for (int fd : m_fd)
+            {
+                ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+            }
+
+            u64 values[count];
+
+            for (int i = 0; i < count; ++i)
+            {
+                if (::read(m_fd[i], &values[i], sizeof(u64)) != sizeof(u64))
+                    return false;
+            }
+
+            sample.cycles = values[0];
+            sample.instructions = values[1];
+            sample.cache_misses = values[2];
+            return true;
+        }
+    };
+
+#else
+
+    class Counters
+    {
+    public:
+        bool valid() const
+        {
+            return false;
+        }
+
+        void start()
+        {
+        }
+
+        bool stop(instrument::Sample& sample)
+        {
+            return false;
+        }
+    };
+
+#endif
+
+    Counters& getCounters()
+    {
+        static Counters counters;
+        return counters;
+    }
+
+    // ----------------------------------------------------------------------------
+    // interval
+    // ----------------------------------------------------------------------------
+
+    struct Interval
+    {
+        u64 allocations = 0;
+        u64 bytes = 0;
+        u64 base_rss = 0;
+    };
+
+    Interval g_interval;
+
+} // namespace
+
+// ----------------------------------------------------------------------------
+// allocator
+// ----------------------------------------------------------------------------
+
+#if defined(INSTRUMENT_MALLOC)
+
+// glibc exports its allocator under these names as well; the definitions below
+// interpose the public ones for the executable and every shared library, operator new
+// included as libstdc++ allocates through malloc.
+
+extern "C"
+{
+
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t n, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+
+void* malloc(size_t size)
+{
+    count(size);
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t n, size_t size)
+{
+    count(n * size);
+    return __libc_calloc(n, size);
+}
+
+void* realloc(void* ptr, size_t size)
+{
+    // every resize is counted, in place or not
+    count(size);
+    return __libc_realloc(ptr, size);
+}
+
+void* memalign(size_t alignment, size_t size)
+{
+    count(size);
+    return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size)
+{
+    count(size);
+    return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** ptr, size_t alignment, size_t size)
+{
+    if (alignment < sizeof(void*) || (alignment & (alignment - 1)) != 0)
+        return EINVAL;
+
+    count(size);
+
+    void* p = __libc_memalign(alignment, size);
+    if (!p)
+        return ENOMEM;
+
+    *ptr = p;
+    return 0;
+}
+
+} // extern "C"
+
+#else
+
+// Only the C++ allocations are visible; the aligned and nothrow forms end up here
+// or keep their default implementation which is paired with its own delete.
+
+void* operator new(size_t size)
+{
+    count(size);
+    if (void* ptr = std::malloc(size ? size : 1))
+        return ptr;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+#endif
+
+// ----------------------------------------------------------------------------
+// instrument
+// ----------------------------------------------------------------------------
+
+namespace instrument
+{
+
+    void begin()
+    {
+        g_interval.base_rss = resetPeakRSS() ? getPeakRSS() : 0;
+        g_interval.allocations = g_allocations.load(std::memory_order_relaxed);
+        g_interval.bytes = g_bytes.load(std::memory_order_relaxed);
+
+        // last so that the bookkeeping above is not counted
+        getCounters().start();
+    }
+
+    Sample end()
+    {
+        Sample sample;
+
+        sample.counters = getCounters().stop(sample);
+        sample.allocations = g_allocations.load(std::memory_order_relaxed) - g_interval.allocations;
+        sample.bytes = g_bytes.load(std::memory_order_relaxed) - g_interval.bytes;
+        sample.peak_rss = getPeakRSS();
+        sample.base_rss = g_interval.base_rss;
+
+        return sample;
+    }
+
+    const char* allocator()
+    {
+#if defined(INSTRUMENT_MALLOC)
+        return "malloc";
+#else
+        return "operator new";
+#endif
+    }
+
+    bool counters()
+    {
+        return getCounters().valid();
+    }
+
+} // namespace instrument
@@ -0,0 +1,47 @@
+/*
+    MANGO Multimedia Development Platform
+    Copyright (C) 2012-2025 Twilight Finland 3D Oy Ltd. All rights reserved.
+*/
+#pragma once
+
+#include <mango/mango.hpp>
+
+namespace instrument
+{
+    using mango::u64;
+
+    // Cost of a measured interval beyond the wall clock time.
+    //
+    // Heap allocations are counted process-wide: on glibc the malloc family is
+    // interposed which covers mango buffers and C libraries, elsewhere only the C++
+    // operator new is replaced. The hardware counters come from perf_event_open and
+    // cover the thread which first uses them and the threads it creates afterwards;
+    // call counters() early so that the thread pool is started after them.
+
+    struct Sample
+    {
+        u64 allocations = 0;   // number of heap allocations
+        u64 bytes = 0;         // bytes requested by them
+        u64 peak_rss = 0;      // peak resident set size in bytes, 0 when not available
+        u64 base_rss = 0;      // resident set size at begin(), 0 when the peak cannot be reset
+
+        bool counters = false; // the hardware counters below are valid
+        u64 cycles = 0;
+        u64 instructions = 0;
+        u64 cache_misses = 0;  // last level cache, each one is a cache line from memory
+    };
+
+    // start a new interval
+    void begin();
+
+    // statistics since begin()
+    Sample end();
+
+    // what the allocation counts cover: "malloc" or "operator new"
+    const char* allocator();
+
+    // opens the hardware counters on first use;
+    // false when perf_event_open is not supported or not permitted
+    bool counters();
+
+} // namespace instrument
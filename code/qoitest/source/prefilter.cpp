@@ -0,0 +1,498 @@
+/*
+    MANGO Multimedia Development Platform
+    Copyright (C) 2012-2025 Twilight Finland 3D Oy Ltd. All rights reserved.
+*/
+#include "prefilter.hpp"
+
+#if defined(MANGO_CPU_INTEL)
+    #include <immintrin.h>
+    #if defined(__GNUC__) || defined(__clang__)
+        #define PREFILTER_TARGET_SSSE3 __attribute__((target("ssse3")))
+        #define PREFILTER_TARGET_AVX2 __attribute__((target("avx2")))
+    #else
+        #define PREFILTER_TARGET_SSSE3
+        #define PREFILTER_TARGET_AVX2
+    #endif
+#elif defined(__ARM_NEON)
+    #include <arm_neon.h>
+#endif
+
+namespace
+{
+    using namespace mango;
+
+    // ----------------------------------------------------------------------------
+    // scalar
+    // ----------------------------------------------------------------------------
+
+    // process pixels from i to count; the SIMD loops leave the tail to these
+
+    void encode_scalar(u8* dest, const u8* src, size_t i, size_t count, bool delta)
+    {
+        u8 prev[4] = { 0, 0, 0, 0 };
+
+        if (delta && i > 0)
+        {
+            std::memcpy(prev, src + (i - 1) * 4, 4);
+        }
+
+        for ( ; i < count; ++i)
+        {
+            for (int c = 0; c < 4; ++c)
+            {
+                u8 value = src[i * 4 + c];
+                dest[c * count + i] = delta ? u8(value - prev[c]) : value;
+                prev[c] = value;
+            }
+        }
+    }
+
+    void decode_scalar(u8* dest, const u8* src, size_t i, size_t count, bool delta)
+    {
+        u8 prev[4] = { 0, 0, 0, 0 };
+
+        if (delta && i > 0)
+        {
+            std::memcpy(prev, dest + (i - 1) * 4, 4);
+        }
+
+        for ( ; i < count; ++i)
+        {
+            for (int c = 0; c < 4; ++c)
+            {
+                u8 value = src[c * count + i];
+                if (delta)
+                {
+                    value += prev[c];
+                    prev[c] = value;
+                }
+                dest[i * 4 + c] = value;
+            }
+        }
+    }
+
+#if defined(MANGO_CPU_INTEL)
+
+    // ----------------------------------------------------------------------------
+    // ssse3
+    // ----------------------------------------------------------------------------
+
+    PREFILTER_TARGET_SSSE3
+    inline __m128i load(const u8* p)
+    {
+        return _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    }
+
+    PREFILTER_TARGET_SSSE3
+    inline void store(u8* p, __m128i v)
+    {
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(p), v);
+    }
+
+    // v[i] - v[i - 1], where v[-1] is the last byte of prev
+    PREFILTER_TARGET_SSSE3
+    inline __m128i delta_encode(__m128i v, __m128i prev)
+    {
+        return _mm_sub_epi8(v, _mm_alignr_epi8(v, prev, 15));
+    }
+
+    // running sum of the bytes, continuing from the last byte of prev
+    PREFILTER_TARGET_SSSE3
+    inline __m128i delta_decode(__m128i v, __m128i prev)
+    {
+        v = _mm_add_epi8(v, _mm_slli_si128(v, 1));
+        v = _mm_add_epi8(v, _mm_slli_si128(v, 2));
+        v = _mm_add_epi8(v, _mm_slli_si128(v, 4));
+        v = _mm_add_epi8(v, _mm_slli_si128(v, 8));
+        return _mm_add_epi8(v, _mm_shuffle_epi8(prev, _mm_set1_epi8(15)));
+    }
+
+    PREFILTER_TARGET_SSSE3
+    size_t encode_ssse3(u8* dest, const u8* src, size_t count, bool delta)
+    {
+        const __m128i mask = _mm_setr_epi8(0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+
+        __m128i prev_r = _mm_setzero_si128();
+        __m128i prev_g = _mm_setzero_si128();
+        __m128i prev_b = _mm_setzero_si128();
+        __m128i prev_a = _mm_setzero_si128();
+
+        size_t i = 0;
+
+        for ( ; i + 16 <= count; i += 16)
+        {
+            // 4 pixels per register, grouped by channel: rrrr gggg bbbb aaaa
+            __m128i v0 = _mm_shuffle_epi8(load(src + i * 4 +  0), mask);
+            __m128i v1 = _mm_shuffle_epi8(load(src + i * 4 + 16), mask);
+            __m128i v2 = _mm_shuffle_epi8(load(src + i * 4 + 32), mask);
+            __m128i v3 = _mm_shuffle_epi8(load(src + i * 4 + 48), mask);
+
+            // transpose the 32 bit groups
+            __m128i t0 = _mm_unpacklo_epi32(v0, v1);
+            __m128i t1 = _mm_unpackhi_epi32(v0, v1);
+            __m128i t2 = _mm_unpacklo_epi32(v2, v3);
+            __m128i t3 = _mm_unpackhi_epi32(v2, v3);
+
+            __m128i r = _mm_unpacklo_epi64(t0, t2);
+            __m128i g = _mm_unpackhi_epi64(t0, t2);
+            __m128i b = _mm_unpacklo_epi64(t1, t3);
+            __m128i a = _mm_unpackhi_epi64(t1, t3);
+
+            if (delta)
+            {
+                __m128i dr = delta_encode(r, prev_r);
+                __m128i dg = delta_encode(g, prev_g);
+                __m128i db = delta_encode(b, prev_b);
+                __m128i da = delta_encode(a, prev_a);
+                prev_r = r;
+                prev_g = g;
+                prev_b = b;
+                prev_a = a;
+                r = dr;
+                g = dg;
+                b = db;
+                a = da;
+            }
+
+            store(dest + count * 0 + i, r);
+            store(dest + count * 1 + i, g);
+            store(dest + count * 2 + i, b);
+            store(dest + count * 3 + i, a);
+        }
+
+        return i;
+    }
+
+    PREFILTER_TARGET_SSSE3
+    size_t decode_ssse3(u8* dest, const u8* src, size_t count, bool delta)
+    {
+        __m128i prev_r = _mm_setzero_si128();
+        __m128i prev_g = _mm_setzero_si128();
+        __m128i prev_b = _mm_setzero_si128();
+        __m128i prev_a = _mm_setzero_si128();
+
+        size_t i = 0;
+
+        for ( ; i + 16 <= count; i += 16)
+        {
+            __m128i r = load(src + count * 0 + i);
+            __m128i g = load(src + count * 1 + i);
+            __m128i b = load(src + count * 2 + i);
+            __m128i a = load(src + count * 3 + i);
+
+            if (delta)
+            {
+                r = prev_r = delta_decode(r, prev_r);
+                g = prev_g = delta_decode(g, prev_g);
+                b = prev_b = delta_decode(b, prev_b);
+                a = prev_a = delta_decode(a, prev_a);
+            }
+
+            __m128i rg0 = _mm_unpacklo_epi8(r, g);
+            __m128i rg1 = _mm_unpackhi_epi8(r, g);
+            __m128i ba0 = _mm_unpacklo_epi8(b, a);
+            __m128i ba1 = _mm_unpackhi_epi8(b, a);
+
+            store(dest + i * 4 +  0, _mm_unpacklo_epi16(rg0, ba0));
+            store(dest + i * 4 + 16, _mm_unpackhi_epi16(rg0, ba0));
+            store(dest + i * 4 + 32, _mm_unpacklo_epi16(rg1, ba1));
+            store(dest + i * 4 + 48, _mm_unpackhi_epi16(rg1, ba1));
+        }
+
+        return i;
+    }
+
+    // ----------------------------------------------------------------------------
+    // avx2
+    // ----------------------------------------------------------------------------
+
+    // The byte shuffles and unpacks work within 128 bit lanes; the lanes are put in
+    // order with cross-lane permutes.
+
+    PREFILTER_TARGET_AVX2
+    inline __m256i load256(const u8* p)
+    {
+        return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    }
+
+    PREFILTER_TARGET_AVX2
+    inline void store256(u8* p, __m256i v)
+    {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(p), v);
+    }
+
+    PREFILTER_TARGET_AVX2
+    inline __m256i delta_encode256(__m256i v, __m256i prev)
+    {
+        // previous byte for each lane: high lane of prev, low lane of v
+        __m256i carry = _mm256_permute2x128_si256(prev, v, 0x21);
+        return _mm256_sub_epi8(v, _mm256_alignr_epi8(v, carry, 15));
+    }
+
+    PREFILTER_TARGET_AVX2
+    inline __m256i delta_decode256(__m256i v, __m256i prev)
+    {
+        const __m256i last = _mm256_set1_epi8(15);
+
+        v = _mm256_add_epi8(v, _mm256_slli_si256(v, 1));
+        v = _mm256_add_epi8(v, _mm256_slli_si256(v, 2));
+        v = _mm256_add_epi8(v, _mm256_slli_si256(v, 4));
+        v = _mm256_add_epi8(v, _mm256_slli_si256(v, 8));
+
+        // carry the sum of the low lane into the high lane
+        __m256i sum = _mm256_shuffle_epi8(v, last);
+        v = _mm256_add_epi8(v, _mm256_permute2x128_si256(sum, sum, 0x08));
+
+        // last byte of prev into both lanes
+        __m256i carry = _mm256_shuffle_epi8(prev, last);
+        return _mm256_add_epi8(v, _mm256_permute2x128_si256(carry, carry, 0x11));
+    }
+
+    PREFILTER_TARGET_AVX2
+    size_t encode_avx2(u8* dest, const u8* src, size_t count, bool delta)
+    {
+        const __m256i mask = _mm256_setr_epi8(
+            0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15,
+            0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15);
+        const __m256i order = _mm256_setr_epi32(0, 4, 1, 5, 2, 6, 3, 7);
+
+        __m256i prev_r = _mm256_setzero_si256();
+        __m256i prev_g = _mm256_setzero_si256();
+        __m256i prev_b = _mm256_setzero_si256();
+        __m256i prev_a = _mm256_setzero_si256();
+
+        size_t i = 0;
+
+        for ( ; i + 32 <= count; i += 32)
+        {
+            __m256i v0 = _mm256_shuffle_epi8(load256(src + i * 4 +  0), mask);
+            __m256i v1 = _mm256_shuffle_epi8(load256(src + i * 4 + 32), mask);
+            __m256i v2 = _mm256_shuffle_epi8(load256(src + i * 4 + 64), mask);
+            __m256i v3 = _mm256_shuffle_epi8(load256(src + i * 4 + 96), mask);
+
+            __m256i t0 = _mm256_unpacklo_epi32(v0, v1);
+            __m256i t1 = _mm256_unpackhi_epi32(v0, v1);
+            __m256i t2 = _mm256_unpacklo_epi32(v2, v3);
+            __m256i t3 = _mm256_unpackhi_epi32(v2, v3);
+
+            // groups of 4 pixels are in order 0, 2, 4, 6, 1, 3, 5, 7
+            __m256i r = _mm256_permutevar8x32_epi32(_mm256_unpacklo_epi64(t0, t2), order);
+            __m256i g = _mm256_permutevar8x32_epi32(_mm256_unpackhi_epi64(t0, t2), order);
+            __m256i b = _mm256_permutevar8x32_epi32(_mm256_unpacklo_epi64(t1, t3), order);
+            __m256i a = _mm256_permutevar8x32_epi32(_mm256_unpackhi_epi64(t1, t3), order);
+
+            if (delta)
+            {
+                __m256i dr = delta_encode256(r, prev_r);
+                __m256i dg = delta_encode256(g, prev_g);
+                __m256i db = delta_encode256(b, prev_b);
+                __m256i da = delta_encode256(a, prev_a);
+                prev_r = r;
+                prev_g = g;
+                prev_b = b;
+                prev_a = a;
+                r = dr;
+                g = dg;
+                b = db;
+                a = da;
+            }
+
+            store256(dest + count * 0 + i, r);
+            store256(dest + count * 1 + i, g);
+            store256(dest + count * 2 + i, b);
+            store256(dest + count * 3 + i, a);
+        }
+
+        return i;
+    }
+
+    PREFILTER_TARGET_AVX2
+    size_t decode_avx2(u8* dest, const u8* src, size_t count, bool delta)
+    {
+        __m256i prev_r = _mm256_setzero_si256();
+        __m256i prev_g = _mm256_setzero_si256();
+        __m256i prev_b = _mm256_setzero_si256();
+        __m256i prev_a = _mm256_setzero_si256();
+
+        size_t i = 0;
+
+        for ( ; i + 32 <= count; i += 32)
+        {
+            __m256i r = load256(src + count * 0 + i);
+            __m256i g = load256(src + count * 1 + i);
+            __m256i b = load256(src + count * 2 + i);
+            __m256i a = load256(src + count * 3 + i);
+
+            if (delta)
+            {
+                r = prev_r = delta_decode256(r, prev_r);
+                g = prev_g = delta_decode256(g, prev_g);
+                b = prev_b = delta_decode256(b, prev_b);
+                a = prev_a = delta_decode256(a, prev_a);
+            }
+
+            __m256i rg0 = _mm256_unpacklo_epi8(r, g);
+            __m256i rg1 = _mm256_unpackhi_epi8(r, g);
+            __m256i ba0 = _mm256_unpacklo_epi8(b, a);
+            __m256i ba1 = _mm256_unpackhi_epi8(b, a);
+
+            // pixels 0..3 | 16..19, 4..7 | 20..23, 8..11 | 24..27, 12..15 | 28..31
+            __m256i p0 = _mm256_unpacklo_epi16(rg0, ba0);
+            __m256i p1 = _mm256_unpackhi_epi16(rg0, ba0);
+            __m256i p2 = _mm256_unpacklo_epi16(rg1, ba1);
+            __m256i p3 = _mm256_unpackhi_epi16(rg1, ba1);
+
+            store256(dest + i * 4 +  0, _mm256_permute2x128_si256(p0, p1, 0x20));
+            store256(dest + i * 4 + 32, _mm256_permute2x128_si256(p2, p3, 0x20));
+            store256(dest + i * 4 + 64, _mm256_permute2x128_si256(p0, p1, 0x31));
+            store256(dest + i * 4 + 96, _mm256_permute2x128_si256(p2, p3, 0x31));
+        }
+
+        return i;
+    }
+
+#elif defined(__ARM_NEON)
+
+    // ----------------------------------------------------------------------------
+    // neon
+    // ----------------------------------------------------------------------------
+
+    inline uint8x16_t delta_decode(uint8x16_t v, uint8x16_t prev)
+    {
+        const uint8x16_t zero = vdupq_n_u8(0);
+        v = vaddq_u8(v, vextq_u8(zero, v, 15));
+        v = vaddq_u8(v, vextq_u8(zero, v, 14));
+        v = vaddq_u8(v, vextq_u8(zero, v, 12));
+        v = vaddq_u8(v, vextq_u8(zero, v, 8));
+        return vaddq_u8(v, vdupq_n_u8(vgetq_lane_u8(prev, 15)));
+    }
+
+    size_t encode_neon(u8* dest, const u8* src, size_t count, bool delta)
+    {
+        uint8x16x4_t prev;
+        for (int c = 0; c < 4; ++c)
+        {
+            prev.val[c] = vdupq_n_u8(0);
+        }
+
+        size_t i = 0;
+
+        for ( ; i + 16 <= count; i += 16)
+        {
+            uint8x16x4_t v = vld4q_u8(src + i * 4);
+
+            for (int c = 0; c < 4; ++c)
+            {
+                uint8x16_t value = v.val[c];
+                if (delta)
+                {
+                    value = vsubq_u8(value, vextq_u8(prev.val[c], value, 15));
+                    prev.val[c] = v.val[c];
+                }
+                vst1q_u8(dest + count * c + i, value);
+            }
+        }
+
+        return i;
+    }
+
+    size_t decode_neon(u8* dest, const u8* src, size_t count, bool delta)
+    {
+        uint8x16x4_t prev;
+        for (int c = 0; c < 4; ++c)
+        {
+            prev.val[c] = vdupq_n_u8(0);
+        }
+
+        size_t i = 0;
+
+        for ( ; i + 16 <= count; i += 16)
+        {
+            uint8x16x4_t v;
+
+            for (int c = 0; c < 4; ++c)
+            {
+                v.val[c] = vld1q_u8(src + count * c + i);
+                if (delta)
+                {
+                    v.val[c] = prev.val[c] = delta_decode(v.val[c], prev.val[c]);
+                }
+            }
+
+            vst4q_u8(dest + i * 4, v);
+        }
+
+        return i;
+    }
+
+#endif
+
+    // ----------------------------------------------------------------------------
+    // kernel selection
+    // ----------------------------------------------------------------------------
+
+    // the SIMD kernels return the number of pixels processed; the scalar loop does the rest
+    using KernelFunc = size_t (*)(u8* dest, const u8* src, size_t count, bool delta);
+
+    size_t none(u8* dest, const u8* src, size_t count, bool delta)
+    {
+        return 0;
+    }
+
+    struct Kernel
+    {
+        KernelFunc encode;
+        KernelFunc decode;
+        const char* name;
+    };
+
+    Kernel selectKernel()
+    {
+        Kernel kernel = { none, none, "scalar" };
+
+#if defined(MANGO_CPU_INTEL)
+        u64 flags = getCPUFlags();
+        if (flags & INTEL_AVX2)
+        {
+            kernel = { encode_avx2, decode_avx2, "avx2" };
+        }
+        else if (flags & INTEL_SSSE3)
+        {
+            kernel = { encode_ssse3, decode_ssse3, "ssse3" };
+        }
+#elif defined(__ARM_NEON)
+        kernel = { encode_neon, decode_neon, "neon" };
+#endif
+
+        return kernel;
+    }
+
+    const Kernel& getKernel()
+    {
+        static Kernel kernel = selectKernel();
+        return kernel;
+    }
+
+} // namespace
+
+namespace prefilter
+{
+
+    void encode(u8* dest, const u8* src, size_t count, bool delta)
+    {
+        size_t i = getKernel().encode(dest, src, count, delta);
+        encode_scalar(dest, src, i, count, delta);
+    }
+
+    void decode(u8* dest, const u8* src, size_t count, bool delta)
+    {
+        size_t i = getKernel().decode(dest, src, count, delta);
+        decode_scalar(dest, src, i, count, delta);
+    }
+
+    const char* kernel()
+    {
+        return getKernel().name;
+    }
+
+} // namespace prefilter
@@ -0,0 +1,25 @@
+/*
+    MANGO Multimedia Development Platform
+    Copyright (C) 2012-2025 Twilight Finland 3D Oy Ltd. All rights reserved.
+*/
+#pragma once
+
+#include <mango/mango.hpp>
+
+namespace prefilter
+{
+    using mango::u8;
+
+    // Byte shuffle for general purpose compressors: interleaved RGBA pixels are split
+    // into four planes (all reds, then greens, blues and alphas) and, optionally, each
+    // plane is delta coded against the previous byte. Similar bytes end up next to each
+    // other which LZ matchers and entropy coders exploit much better.
+    // The buffers hold count pixels (count * 4 bytes) and must not overlap.
+
+    void encode(u8* dest, const u8* src, size_t count, bool delta);
+    void decode(u8* dest, const u8* src, size_t count, bool delta);
+
+    // name of the kernel selected for this CPU
+    const char* kernel();
+
+} // namespace prefilter
@@ -65,9 +65,17 @@ void *rgba_pixels = qoi_read("image.qoi", &desc, 4);
 
 This library provides the following functions;
 - qoi_read    -- read and decode a QOI file
+- QOIFile     -- memory mapped QOI file, decoded straight from the mapping
+- qoi_read_header  -- validate the file header
+- qoi_write_header -- store the file header
 - qoi_decode  -- decode the raw bytes of a QOI image from memory
+- qoi_decode_surface -- decode into a Surface, converting to its format
 - qoi_write   -- encode and write a QOI file
 - qoi_encode  -- encode an rgba buffer into a QOI image in memory
+- qoi_encode_restart -- encode with restart points for parallel decoding
+- qoi_restart_table  -- read the restart points of an encoded image
+- qoi_encode_batch   -- encode many images into one arena
+- qoi_decode_batch   -- decode many images from an arena
 
 See the function declaration below for the signature and more information.
 
@@ -209,6 +217,21 @@ The byte stream is padded at the end with 4 zero bytes. Size the longest chunk
 we can encounter is 5 bytes (QOI_COLOR with RGBA set), with this padding we just
 have to check for an overrun once per decode loop iteration.
 
+
+-- Restart points
+
+qoi_encode_restart() starts every band of N scanlines with a fresh state. The first
+pixel of a band is a QOI_COLOR with all four channels and a QOI_INDEX only refers to
+entries written within the band, so the stream remains valid for a decoder which does
+not know about the bands. The padding is followed by a trailer:
+
+struct qoi_restart_trailer_t {
+    uint32_t offset[count]; // byte offset of each band (LE)
+    uint32_t interval;      // scanlines per band (LE)
+    uint32_t count;         // number of bands (LE)
+    char     magic[4];      // magic bytes "qoir"
+};
+
 */
 
 
@@ -229,7 +252,7 @@ extern "C" {
 // The function either returns NULL on failure (invalid parameters or malloc 
 // failed) or a pointer to the encoded data on success. On success the out_len
 // is set to the size in bytes of the encoded data.
-// The returned qoi data should be free()d after user.
+// The returned qoi data is allocated with new[] and must be released with delete[].
 
 mango::u8* qoi_encode(const mango::u8* image, size_t stride, int w, int h, size_t* out_len);
 
@@ -243,8 +266,135 @@ mango::u8* qoi_encode(const mango::u8* image, size_t stride, int w, int h, size_
 
 void qoi_decode(unsigned char* image, const mango::u8* data, size_t size, int w, int h, size_t stride);
 
+
+// Encode with the prediction state (previous pixel, index and run) reset every
+// interval scanlines. The result is an ordinary QOI stream which qoi_decode() decodes
+// as usual, followed by a trailer with the byte offsets of the restart points so
+// that the bands between them can be decoded independently.
+
+mango::u8* qoi_encode_restart(const mango::u8* image, size_t stride, int w, int h, int interval, size_t* out_len);
+
+
+// Read the restart trailer. Stores up to max_count band offsets and returns how many
+// were stored, 0 when the stream has no valid trailer; band i covers the scanlines
+// starting at i * interval and qoi_decode() decodes it from data + offsets[i].
+
+int qoi_restart_table(const mango::u8* data, size_t size, mango::u32* offsets, int max_count, int* interval);
+
+
+// The 14 byte file header in front of the encoded data, see Data Format.
+
+#define QOI_HEADER_SIZE 14
+
+typedef struct {
+    unsigned int width;
+    unsigned int height;
+    unsigned char channels;
+    unsigned char colorspace;
+} qoi_desc;
+
+// Returns 1 and fills desc when data starts with a valid header followed by at least
+// the padding, otherwise 0. The dimensions are limited to what qoi_encode() accepts.
+
+int qoi_read_header(const mango::u8* data, size_t size, qoi_desc* desc);
+
+void qoi_write_header(mango::u8* data, const qoi_desc* desc);
+
 #ifdef __cplusplus
 }
+
+// Decode into a Surface of any format. RGBA, BGRA, RGB, BGR and RGB565 are written
+// directly as the pixels are decoded, other formats are converted one scanline at a
+// time. premultiply multiplies the color with alpha for every format, also the ones
+// which drop the alpha. Reads stay within size; returns false when the data ends
+// before the image is complete.
+
+bool qoi_decode_surface(const mango::image::Surface& dest, const mango::u8* data, size_t size, bool premultiply = false);
+
+
+// Batch encoding and decoding of many small RGBA images. The encoded images are stored
+// back to back in one arena; image i is at arena[offsets[i]] .. arena[offsets[i + 1]].
+// The work is split into chunks of roughly equal pixel count for the thread pool, so
+// there is no allocation or task per image.
+
+struct QOIBatch
+{
+    std::vector<mango::u8> arena;
+    std::vector<size_t> offsets; // count + 1 entries
+};
+
+void qoi_encode_batch(QOIBatch& batch, const mango::image::Surface* surfaces, size_t count);
+void qoi_decode_batch(const mango::image::Surface* surfaces, size_t count, const QOIBatch& batch);
+
+
+// Incremental qoi_encode_restart() for producers which deliver the image a band at a
+// time. Band i covers the interval scanlines starting at i * interval; the bands are
+// independent so they can be encoded in any order and concurrently. finish() returns
+// the same stream qoi_encode_restart() produces for the whole image.
+
+class QOIRestartEncoder
+{
+protected:
+    int m_width;
+    int m_height;
+    int m_interval;
+    std::vector<std::vector<mango::u8>> m_bands;
+
+public:
+    QOIRestartEncoder(int width, int height, int interval);
+
+    int bands() const;
+
+    // image points to the first scanline of the band
+    void encode(int band, const mango::u8* image, size_t stride);
+
+    std::vector<mango::u8> finish();
+};
+
+
+#ifndef QOI_NO_STDIO
+
+// Encode an RGBA image into a file: the header followed by the qoi_encode() stream.
+// Returns false on failure.
+
+bool qoi_write(const char* filename, const mango::u8* image, size_t stride, int w, int h);
+
+
+// QOI file mapped read-only into memory. The header is validated when the file is
+// opened and decode() works straight from the mapping, hinted for sequential access,
+// so there is neither a read buffer nor a copy. The decoder never reads past the end
+// of the mapping; a truncated or corrupt file throws. Non-POSIX platforms map the
+// file through mango::filesystem::File without the hint.
+
+class QOIFile
+{
+protected:
+    const mango::u8* m_data = nullptr;
+    size_t m_size = 0;
+    qoi_desc m_desc;
+
+#if defined(MANGO_PLATFORM_UNIX)
+    void* m_mapping = nullptr;
+#else
+    std::unique_ptr<mango::filesystem::File> m_file;
+#endif
+
+public:
+    explicit QOIFile(const char* filename);
+    ~QOIFile();
+
+    QOIFile(const QOIFile&) = delete;
+    QOIFile& operator = (const QOIFile&) = delete;
+
+    const qoi_desc& desc() const;
+
+    // dest must have the dimensions of the image, see qoi_decode_surface();
+    // throws when the file ends before the image is complete
+    void decode(const mango::image::Surface& dest, bool premultiply = false) const;
+};
+
+#endif // QOI_NO_STDIO
+
 #endif
 #endif // QOI_H
 
@@ -254,6 +404,16 @@ void qoi_decode(unsigned char* image, const mango::u8* data, size_t size, int w,
 
 #ifdef QOI_IMPLEMENTATION
 
+#ifndef QOI_NO_STDIO
+    #include <cstdio>
+    #if defined(MANGO_PLATFORM_UNIX)
+        #include <fcntl.h>
+        #include <sys/mman.h>
+        #include <sys/stat.h>
+        #include <unistd.h>
+    #endif
+#endif
+
 #define QOI_INDEX   0x00 // 00xxxxxx
 #define QOI_RUN_8   0x40 // 010xxxxx
 #define QOI_RUN_16  0x60 // 011xxxxx
@@ -271,9 +431,11 @@ void qoi_decode(unsigned char* image, const mango::u8* data, size_t size, int w,
 //#define QOI_COLOR_HASH(C) (0x92458355 * C + 0xcb533df9)
 #define QOI_COLOR_HASH(C) (C.r ^ C.g ^ C.b ^ C.a)
 #define QOI_PADDING 4
+#define QOI_RESTART_MAGIC "qoir"
 
 using Color = mango::image::Color;
 using u8 = mango::u8;
+using u16 = mango::u16;
 using u32 = mango::u32;
 
 static inline
@@ -303,32 +465,43 @@ bool is_diff16(int r, int g, int b, int a)
            b >  -8 && b <  9;
 }
 
-u8* qoi_encode(const u8* image, size_t stride, int width, int height, size_t* out_len)
+// Encode scanlines with a fresh state. In RESTART mode the first pixel is written as
+// a full QOI_COLOR and only index entries written in this band are referenced, so the
+// band decodes identically with a fresh state or with whatever state a sequential
+// decoder has at this point. Runs never cross the end of the band.
+template <bool RESTART>
+static
+int qoi_encode_band(u8* bytes, const u8* image, size_t stride, int width, int height)
 {
-    if (image == NULL || out_len == NULL ||
-        width <= 0 || width >= (1 << 16) ||
-        height <= 0 || height >= (1 << 16))
-    {
-        return nullptr;
-    }
-
-    constexpr int channels = 4;
-
-    int max_size = width * height * (channels + 1) + QOI_PADDING;
-    u8* bytes = new u8[max_size];
-    if (!bytes)
-    {
-        return nullptr;
-    }
-
     int p = 0;
 
     Color index[64] = { 0 };
+    mango::u64 valid = 0;
 
     int run = 0;
     Color prev(0, 0, 0, 255);
     Color color = prev;
 
+    int xstart = 0;
+
+    if (RESTART)
+    {
+        color = reinterpret_cast<const Color*>(image)[0];
+
+        bytes[p++] = QOI_COLOR | 0x0f;
+        bytes[p++] = color.r;
+        bytes[p++] = color.g;
+        bytes[p++] = color.b;
+        bytes[p++] = color.a;
+
+        int index_pos = QOI_COLOR_HASH(color) % 64;
+        index[index_pos] = color;
+        valid |= mango::u64(1) << index_pos;
+
+        prev = color;
+        xstart = 1;
+    }
+
     for (int y = 0; y < height; ++y)
     {
         bool is_last_scanline = (y == height - 1);
@@ -336,7 +509,7 @@ u8* qoi_encode(const u8* image, size_t stride, int width, int height, size_t* ou
 
         const Color* src = reinterpret_cast<const Color*>(image);
 
-        for (int x = 0; x < width; ++x)
+        for (int x = xstart; x < width; ++x)
         {
             color = src[x];
 
@@ -367,7 +540,7 @@ u8* qoi_encode(const u8* image, size_t stride, int width, int height, size_t* ou
             {
                 int index_pos = QOI_COLOR_HASH(color) % 64;
 
-                if (index[index_pos] == color)
+                if (index[index_pos] == color && (!RESTART || ((valid >> index_pos) & 1)))
                 {
                     bytes[p++] = QOI_INDEX | index_pos;
                 }
@@ -375,6 +548,11 @@ u8* qoi_encode(const u8* image, size_t stride, int width, int height, size_t* ou
                 {
                     index[index_pos] = color;
 
+                    if (RESTART)
+                    {
+                        valid |= mango::u64(1) << index_pos;
+                    }
+
                     int r = color.r - prev.r;
                     int g = color.g - prev.g;
                     int b = color.b - prev.b;
@@ -433,9 +611,33 @@ u8* qoi_encode(const u8* image, size_t stride, int width, int height, size_t* ou
             prev = color;
         }
 
+        xstart = 0;
         image += stride;
     }
 
+    return p;
+}
+
+u8* qoi_encode(const u8* image, size_t stride, int width, int height, size_t* out_len)
+{
+    if (image == NULL || out_len == NULL ||
+        width <= 0 || width >= (1 << 16) ||
+        height <= 0 || height >= (1 << 16))
+    {
+        return nullptr;
+    }
+
+    constexpr int channels = 4;
+
+    int max_size = width * height * (channels + 1) + QOI_PADDING;
+    u8* bytes = new u8[max_size];
+    if (!bytes)
+    {
+        return nullptr;
+    }
+
+    int p = qoi_encode_band<false>(bytes, image, stride, width, height);
+
     for (int i = 0; i < QOI_PADDING; i++)
     {
         bytes[p++] = 0;
@@ -445,6 +647,180 @@ u8* qoi_encode(const u8* image, size_t stride, int width, int height, size_t* ou
     return bytes;
 }
 
+// Band offsets, interval, band count and magic; returns the number of bytes written.
+static
+int qoi_store_restart_trailer(u8* bytes, const u32* offsets, int count, int interval)
+{
+    int p = 0;
+
+    for (int i = 0; i < count; ++i)
+    {
+        mango::littleEndian::ustore32(bytes + p, offsets[i]);
+        p += 4;
+    }
+
+    mango::littleEndian::ustore32(bytes + p + 0, u32(interval));
+    mango::littleEndian::ustore32(bytes + p + 4, u32(count));
+    std::memcpy(bytes + p + 8, QOI_RESTART_MAGIC, 4);
+    p += 12;
+
+    return p;
+}
+
+u8* qoi_encode_restart(const u8* image, size_t stride, int width, int height, int interval, size_t* out_len)
+{
+    if (image == NULL || out_len == NULL ||
+        width <= 0 || width >= (1 << 16) ||
+        height <= 0 || height >= (1 << 16) ||
+        interval <= 0)
+    {
+        return nullptr;
+    }
+
+    constexpr int channels = 4;
+
+    int count = (height + interval - 1) / interval;
+
+    int max_size = width * height * (channels + 1) + QOI_PADDING + (count + 3) * 4;
+    u8* bytes = new u8[max_size];
+    if (!bytes)
+    {
+        return nullptr;
+    }
+
+    std::vector<u32> offsets(count);
+
+    int p = 0;
+
+    for (int i = 0; i < count; ++i)
+    {
+        int y = i * interval;
+        int h = std::min(interval, height - y);
+
+        offsets[i] = u32(p);
+        p += qoi_encode_band<true>(bytes + p, image + y * stride, stride, width, h);
+    }
+
+    for (int i = 0; i < QOI_PADDING; i++)
+    {
+        bytes[p++] = 0;
+    }
+
+    p += qoi_store_restart_trailer(bytes + p, offsets.data(), count, interval);
+
+    *out_len = p;
+    return bytes;
+}
+
+QOIRestartEncoder::QOIRestartEncoder(int width, int height, int interval)
+    : m_width(width)
+    , m_height(height)
+    , m_interval(interval)
+{
+    if (width <= 0 || width >= (1 << 16) ||
+        height <= 0 || height >= (1 << 16) ||
+        interval <= 0)
+    {
+        MANGO_EXCEPTION("[QOIRestartEncoder] Invalid dimensions.");
+    }
+
+    m_bands.resize((height + interval - 1) / interval);
+}
+
+int QOIRestartEncoder::bands() const
+{
+    return int(m_bands.size());
+}
+
+void QOIRestartEncoder::encode(int band, const u8* image, size_t stride)
+{
+    if (band < 0 || band >= bands())
+    {
+        MANGO_EXCEPTION("[QOIRestartEncoder] Invalid band.");
+    }
+
+    int h = std::min(m_interval, m_height - band * m_interval);
+
+    std::vector<u8>& buffer = m_bands[band];
+    buffer.resize(size_t(m_width) * h * 5);
+
+    int p = qoi_encode_band<true>(buffer.data(), image, stride, m_width, h);
+    buffer.resize(p);
+}
+
+std::vector<u8> QOIRestartEncoder::finish()
+{
+    const int count = bands();
+
+    std::vector<u32> offsets(count);
+    size_t p = 0;
+
+    for (int i = 0; i < count; ++i)
+    {
+        if (m_bands[i].empty())
+        {
+            // a band is never encoded into zero bytes
+            MANGO_EXCEPTION("[QOIRestartEncoder] Band is not encoded.");
+        }
+
+        offsets[i] = u32(p);
+        p += m_bands[i].size();
+    }
+
+    std::vector<u8> output(p + QOI_PADDING + (count + 3) * 4);
+    u8* bytes = output.data();
+
+    for (int i = 0; i < count; ++i)
+    {
+        std::memcpy(bytes + offsets[i], m_bands[i].data(), m_bands[i].size());
+        std::vector<u8>().swap(m_bands[i]);
+    }
+
+    for (int i = 0; i < QOI_PADDING; i++)
+    {
+        bytes[p++] = 0;
+    }
+
+    qoi_store_restart_trailer(bytes + p, offsets.data(), count, m_interval);
+
+    return output;
+}
+
+int qoi_restart_table(const u8* data, size_t size, u32* offsets, int max_count, int* interval)
+{
+    if (size < 12 || std::memcmp(data + size - 4, QOI_RESTART_MAGIC, 4))
+    {
+        return 0;
+    }
+
+    u32 count = mango::littleEndian::uload32(data + size - 8);
+    if (count == 0 || size < 12 + size_t(count) * 4 + QOI_PADDING)
+    {
+        return 0;
+    }
+
+    if (interval)
+    {
+        *interval = int(mango::littleEndian::uload32(data + size - 12));
+    }
+
+    const u8* table = data + size - 12 - count * 4;
+    const size_t end = size_t(table - data);
+
+    int n = int(std::min(count, u32(std::max(max_count, 0))));
+    for (int i = 0; i < n; ++i)
+    {
+        offsets[i] = mango::littleEndian::uload32(table + i * 4);
+        if (offsets[i] >= end)
+        {
+            // the band would start inside the trailer
+            return 0;
+        }
+    }
+
+    return n;
+}
+
 /*
 
 u8* qoi_encode(const u8* image, size_t stride, int width, int height, size_t* out_len)
@@ -591,28 +967,170 @@ u8* qoi_encode(const u8* image, size_t stride, int width, int height, size_t* ou
 
 */
 
-void qoi_decode(u8* image, const u8* data, size_t size, int width, int height, size_t stride)
+// Output writers: store one decoded pixel at dest in the destination format and
+// optionally post-process a finished scanline. The conversion happens while the
+// pixel is still in registers, so there is no second pass over the image.
+
+struct QOIWriterRGBA
+{
+    static constexpr int size = 4;
+
+    void operator () (u8* dest, Color color)
+    {
+        *reinterpret_cast<Color*>(dest) = color;
+    }
+
+    void scanline(int y)
+    {
+    }
+};
+
+static inline
+u8 qoi_multiply(u8 c, u8 a)
+{
+    u32 x = u32(c) * a + 128;
+    return u8((x + (x >> 8)) >> 8);
+}
+
+static inline
+Color qoi_premultiply(Color color)
+{
+    color.r = qoi_multiply(color.r, color.a);
+    color.g = qoi_multiply(color.g, color.a);
+    color.b = qoi_multiply(color.b, color.a);
+    return color;
+}
+
+template <bool PREMULTIPLY, bool SWAP_RB>
+struct QOIWriter32
+{
+    static constexpr int size = 4;
+
+    void operator () (u8* dest, Color color)
+    {
+        if (PREMULTIPLY)
+        {
+            color = qoi_premultiply(color);
+        }
+
+        if (SWAP_RB)
+        {
+            std::swap(color.r, color.b);
+        }
+
+        *reinterpret_cast<Color*>(dest) = color;
+    }
+
+    void scanline(int y)
+    {
+    }
+};
+
+template <bool PREMULTIPLY, bool SWAP_RB>
+struct QOIWriter24
+{
+    static constexpr int size = 3;
+
+    void operator () (u8* dest, Color color)
+    {
+        if (PREMULTIPLY)
+        {
+            color = qoi_premultiply(color);
+        }
+
+        dest[0] = SWAP_RB ? color.b : color.r;
+        dest[1] = color.g;
+        dest[2] = SWAP_RB ? color.r : color.b;
+    }
+
+    void scanline(int y)
+    {
+    }
+};
+
+template <bool PREMULTIPLY>
+struct QOIWriterRGB565
+{
+    static constexpr int size = 2;
+
+    void operator () (u8* dest, Color color)
+    {
+        if (PREMULTIPLY)
+        {
+            color = qoi_premultiply(color);
+        }
+
+        u16 pixel = ((color.r & 0xf8) << 8) | ((color.g & 0xfc) << 3) | (color.b >> 3);
+        mango::littleEndian::ustore16(dest, pixel);
+    }
+
+    void scanline(int y)
+    {
+    }
+};
+
+// Any other format: the scanline is decoded into a small RGBA buffer which is
+// converted into the destination while it is still in the cache.
+template <bool PREMULTIPLY>
+struct QOIWriterBlit
+{
+    static constexpr int size = 4;
+
+    QOIWriter32<PREMULTIPLY, false> convert;
+    const mango::image::Surface& target;
+    mango::image::Surface source;
+
+    QOIWriterBlit(const mango::image::Surface& target, u8* scanline)
+        : target(target)
+        , source(target.width, 1, mango::image::Format(32, mango::image::Format::UNORM, mango::image::Format::RGBA, 8, 8, 8, 8), target.width * 4, scanline)
+    {
+    }
+
+    void operator () (u8* dest, Color color)
+    {
+        convert(dest, color);
+    }
+
+    void scanline(int y)
+    {
+        mango::image::Surface row(target, 0, y, target.width, 1);
+        row.blit(0, 0, source);
+    }
+};
+
+// Returns false when the data runs out before the image is complete. An operation is
+// at most 5 bytes, so an operation which starts before the padding is always inside
+// the data and one check per operation bounds every read.
+template <typename Writer>
+static
+bool qoi_decode_writer(u8* image, const u8* data, size_t size, int width, int height, size_t stride, Writer& writer)
 {
     Color color(0, 0, 0, 255);
     Color index[64] = { 0 };
 
-    //const u8* end = data + size;
+    const u8* end = data + (size > QOI_PADDING ? size - QOI_PADDING : 0);
     int run = 0;
 
     for (int y = 0; y < height; ++y)
     {
-        Color* dest = reinterpret_cast<Color*>(image);
-        Color* xend = dest + width;
+        u8* dest = image;
+        u8* xend = dest + width * Writer::size;
 
         for ( ; dest < xend; )
         {
             if (run > 0)
             {
                 --run;
-                *dest++ = color;
+                writer(dest, color);
+                dest += Writer::size;
             }
             else
             {
+                if (data >= end)
+                {
+                    return false;
+                }
+
                 u32 b1 = *data++;
 
                 if ((b1 & QOI_MASK_2) == QOI_INDEX)
@@ -663,12 +1181,408 @@ void qoi_decode(u8* image, const u8* data, size_t size, int width, int height, s
                     index[QOI_COLOR_HASH(color) % 64] = color;
                 }
 
-                *dest++ = color;
+                writer(dest, color);
+                dest += Writer::size;
             }
         }
 
+        writer.scanline(y);
         image += stride;
     }
+
+    return true;
+}
+
+void qoi_decode(u8* image, const u8* data, size_t size, int width, int height, size_t stride)
+{
+    QOIWriterRGBA writer;
+    qoi_decode_writer(image, data, size, width, height, stride, writer);
+}
+
+bool qoi_decode_surface(const mango::image::Surface& dest, const u8* data, size_t size, bool premultiply)
+{
+    using mango::image::Format;
+
+    const Format rgba(32, Format::UNORM, Format::RGBA, 8, 8, 8, 8);
+    const Format bgra(32, Format::UNORM, Format::BGRA, 8, 8, 8, 8);
+    const Format rgb(24, Format::UNORM, Format::RGB, 8, 8, 8, 0);
+    const Format bgr(24, Format::UNORM, Format::BGR, 8, 8, 8, 0);
+    const Format rgb565(16, Format::UNORM, Format::BGR, 5, 6, 5, 0);
+
+    u8* image = dest.image;
+    int width = dest.width;
+    int height = dest.height;
+    size_t stride = dest.stride;
+
+    if (dest.format == rgba)
+    {
+        if (premultiply)
+        {
+            QOIWriter32<true, false> writer;
+            return qoi_decode_writer(image, data, size, width, height, stride, writer);
+        }
+        else
+        {
+            QOIWriterRGBA writer;
+            return qoi_decode_writer(image, data, size, width, height, stride, writer);
+        }
+    }
+    else if (dest.format == bgra)
+    {
+        if (premultiply)
+        {
+            QOIWriter32<true, true> writer;
+            return qoi_decode_writer(image, data, size, width, height, stride, writer);
+        }
+        else
+        {
+            QOIWriter32<false, true> writer;
+            return qoi_decode_writer(image, data, size, width, height, stride, writer);
+        }
+    }
+    else if (dest.format == rgb)
+    {
+        if (premultiply)
+        {
+            QOIWriter24<true, false> writer;
+            return qoi_decode_writer(image, data, size, width, height, stride, writer);
+        }
+        else
+        {
+            QOIWriter24<false, false> writer;
+            return qoi_decode_writer(image, data, size, width, height, stride, writer);
+        }
+    }
+    else if (dest.format == bgr)
+    {
+        if (premultiply)
+        {
+            QOIWriter24<true, true> writer;
+            return qoi_decode_writer(image, data, size, width, height, stride, writer);
+        }
+        else
+        {
+            QOIWriter24<false, true> writer;
+            return qoi_decode_writer(image, data, size, width, height, stride, writer);
+        }
+    }
+    else if (dest.format == rgb565)
+    {
+        if (premultiply)
+        {
+            QOIWriterRGB565<true> writer;
+            return qoi_decode_writer(image, data, size, width, height, stride, writer);
+        }
+        else
+        {
+            QOIWriterRGB565<false> writer;
+            return qoi_decode_writer(image, data, size, width, height, stride, writer);
+        }
+    }
+    else
+    {
+        // the scanline buffer is reused for every row (stride 0)
+        std::vector<Color> scanline(width);
+        u8* temp = reinterpret_cast<u8*>(scanline.data());
+
+        if (premultiply)
+        {
+            QOIWriterBlit<true> writer(dest, temp);
+            return qoi_decode_writer(temp, data, size, width, height, 0, writer);
+        }
+        else
+        {
+            QOIWriterBlit<false> writer(dest, temp);
+            return qoi_decode_writer(temp, data, size, width, height, 0, writer);
+        }
+    }
+}
+
+int qoi_read_header(const u8* data, size_t size, qoi_desc* desc)
+{
+    if (!data || size < QOI_HEADER_SIZE + QOI_PADDING || std::memcmp(data, "qoif", 4))
+    {
+        return 0;
+    }
+
+    u32 width = mango::bigEndian::uload32(data + 4);
+    u32 height = mango::bigEndian::uload32(data + 8);
+    u8 channels = data[12];
+    u8 colorspace = data[13];
+
+    if (width == 0 || width >= (1 << 16) ||
+        height == 0 || height >= (1 << 16) ||
+        (channels != 3 && channels != 4) || colorspace > 0x0f)
+    {
+        return 0;
+    }
+
+    if (desc)
+    {
+        desc->width = width;
+        desc->height = height;
+        desc->channels = channels;
+        desc->colorspace = colorspace;
+    }
+
+    return 1;
+}
+
+void qoi_write_header(u8* data, const qoi_desc* desc)
+{
+    std::memcpy(data, "qoif", 4);
+    mango::bigEndian::ustore32(data + 4, desc->width);
+    mango::bigEndian::ustore32(data + 8, desc->height);
+    data[12] = desc->channels;
+    data[13] = desc->colorspace;
+}
+
+#ifndef QOI_NO_STDIO
+
+bool qoi_write(const char* filename, const u8* image, size_t stride, int width, int height)
+{
+    size_t length;
+    u8* data = qoi_encode(image, stride, width, height, &length);
+    if (!data)
+    {
+        return false;
+    }
+
+    qoi_desc desc;
+    desc.width = width;
+    desc.height = height;
+    desc.channels = 4;
+    desc.colorspace = 0;
+
+    u8 header[QOI_HEADER_SIZE];
+    qoi_write_header(header, &desc);
+
+    bool status = false;
+
+    if (FILE* file = std::fopen(filename, "wb"))
+    {
+        status = std::fwrite(header, 1, QOI_HEADER_SIZE, file) == QOI_HEADER_SIZE &&
+                 std::fwrite(data, 1, length, file) == length;
+        status = (std::fclose(file) == 0) && status;
+    }
+
+    delete[] data;
+    return status;
+}
+
+QOIFile::QOIFile(const char* filename)
+{
+#if defined(MANGO_PLATFORM_UNIX)
+
+    int fd = ::open(filename, O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+    {
+        MANGO_EXCEPTION("[QOIFile] Cannot open file.");
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) != 0 || st.st_size < QOI_HEADER_SIZE + QOI_PADDING)
+    {
+        ::close(fd);
+        MANGO_EXCEPTION("[QOIFile] Incorrect file size.");
+    }
+
+    m_size = size_t(st.st_size);
+    m_mapping = ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+    // the mapping keeps its own reference to the file
+    ::close(fd);
+
+    if (m_mapping == MAP_FAILED)
+    {
+        m_mapping = nullptr;
+        MANGO_EXCEPTION("[QOIFile] Memory mapping failed.");
+    }
+
+    // read ahead aggressively and drop the pages behind the decoder early
+    ::madvise(m_mapping, m_size, MADV_SEQUENTIAL);
+
+    m_data = reinterpret_cast<const u8*>(m_mapping);
+
+#else
+
+    m_file = std::make_unique<mango::filesystem::File>(filename);
+    m_data = m_file->data();
+    m_size = size_t(m_file->size());
+
+#endif
+
+    if (!qoi_read_header(m_data, m_size, &m_desc))
+    {
+#if defined(MANGO_PLATFORM_UNIX)
+        ::munmap(m_mapping, m_size);
+        m_mapping = nullptr;
+#endif
+        MANGO_EXCEPTION("[QOIFile] Incorrect header.");
+    }
+}
+
+QOIFile::~QOIFile()
+{
+#if defined(MANGO_PLATFORM_UNIX)
+    if (m_mapping)
+    {
+        ::munmap(m_mapping, m_size);
+    }
+#endif
+}
+
+const qoi_desc& QOIFile::desc() const
+{
+    return m_desc;
+}
+
+void QOIFile::decode(const mango::image::Surface& dest, bool premultiply) const
+{
+    if (dest.width != int(m_desc.width) || dest.height != int(m_desc.height))
+    {
+        MANGO_EXCEPTION("[QOIFile] Incorrect destination dimensions.");
+    }
+
+    if (!qoi_decode_surface(dest, m_data + QOI_HEADER_SIZE, m_size - QOI_HEADER_SIZE, premultiply))
+    {
+        MANGO_EXCEPTION("[QOIFile] Truncated or corrupt file.");
+    }
+}
+
+#endif // QOI_NO_STDIO
+
+// Image index ranges of roughly equal pixel count; a few per core for load balancing
+// but never so small that the scheduling overhead shows.
+static
+std::vector<size_t> qoi_batch_chunks(const mango::image::Surface* surfaces, size_t count)
+{
+    constexpr mango::u64 min_chunk_pixels = 256 * 256;
+
+    mango::u64 total = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+        total += mango::u64(surfaces[i].width) * surfaces[i].height;
+    }
+
+    mango::u64 cores = std::max(1u, std::thread::hardware_concurrency());
+    mango::u64 target = std::max(total / (cores * 4), min_chunk_pixels);
+
+    std::vector<size_t> bounds { 0 };
+    mango::u64 pixels = 0;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        pixels += mango::u64(surfaces[i].width) * surfaces[i].height;
+        if (pixels >= target)
+        {
+            bounds.push_back(i + 1);
+            pixels = 0;
+        }
+    }
+
+    if (bounds.back() != count)
+    {
+        bounds.push_back(count);
+    }
+
+    return bounds;
+}
+
+void qoi_encode_batch(QOIBatch& batch, const mango::image::Surface* surfaces, size_t count)
+{
+    std::vector<size_t> bounds = qoi_batch_chunks(surfaces, count);
+    const size_t chunks = bounds.size() - 1;
+
+    // each chunk encodes into one worst case scratch buffer
+    std::vector<std::vector<u8>> scratch(chunks);
+    std::vector<size_t> sizes(count, 0);
+
+    mango::ConcurrentQueue q;
+
+    for (size_t c = 0; c < chunks; ++c)
+    {
+        q.enqueue([&, c]
+        {
+            size_t max_size = 0;
+            for (size_t i = bounds[c]; i < bounds[c + 1]; ++i)
+            {
+                max_size += size_t(surfaces[i].width) * surfaces[i].height * 5 + QOI_PADDING;
+            }
+
+            std::vector<u8>& buffer = scratch[c];
+            buffer.resize(max_size);
+
+            u8* bytes = buffer.data();
+            size_t p = 0;
+
+            for (size_t i = bounds[c]; i < bounds[c + 1]; ++i)
+            {
+                const mango::image::Surface& s = surfaces[i];
+                size_t p0 = p;
+
+                p += qoi_encode_band<false>(bytes + p, s.image, s.stride, s.width, s.height);
+
+                for (int j = 0; j < QOI_PADDING; j++)
+                {
+                    bytes[p++] = 0;
+                }
+
+                sizes[i] = p - p0;
+            }
+
+            buffer.resize(p);
+        });
+    }
+
+    q.wait();
+
+    batch.offsets.resize(count + 1);
+    batch.offsets[0] = 0;
+
+    for (size_t i = 0; i < count; ++i)
+    {
+        batch.offsets[i + 1] = batch.offsets[i] + sizes[i];
+    }
+
+    batch.arena.resize(batch.offsets[count]);
+
+    for (size_t c = 0; c < chunks; ++c)
+    {
+        q.enqueue([&, c]
+        {
+            std::memcpy(batch.arena.data() + batch.offsets[bounds[c]], scratch[c].data(), scratch[c].size());
+            std::vector<u8>().swap(scratch[c]);
+        });
+    }
+
+    q.wait();
+}
+
+void qoi_decode_batch(const mango::image::Surface* surfaces, size_t count, const QOIBatch& batch)
+{
+    std::vector<size_t> bounds = qoi_batch_chunks(surfaces, count);
+    const size_t chunks = bounds.size() - 1;
+
+    mango::ConcurrentQueue q;
+
+    for (size_t c = 0; c < chunks; ++c)
+    {
+        q.enqueue([&, c]
+        {
+            for (size_t i = bounds[c]; i < bounds[c + 1]; ++i)
+            {
+                const mango::image::Surface& s = surfaces[i];
+                const u8* data = batch.arena.data() + batch.offsets[i];
+                size_t size = batch.offsets[i + 1] - batch.offsets[i];
+
+                QOIWriterRGBA writer;
+                qoi_decode_writer(s.image, data, size, s.width, s.height, s.stride, writer);
+            }
+        });
+    }
+
+    q.wait();
 }
 
 /*
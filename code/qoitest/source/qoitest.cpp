@@ -4,10 +4,47 @@
 
 #define QOI_IMPLEMENTATION
 #include "qoi.h"
+#include "prefilter.hpp"
+#include "codec.hpp"
+#include "instrument.hpp"
+#include "transcode.hpp"
 
 using namespace mango;
 using namespace mango::image;
 
+// --stats: the tests run back to back so each one is measured from the previous
+// print() to its own, setup and conversions included
+static bool g_stats = false;
+
+void print_stats()
+{
+    instrument::Sample sample = instrument::end();
+
+    printf("          alloc: %6d (%7d KB)", int(sample.allocations), int(sample.bytes / 1024));
+
+    if (sample.base_rss)
+    {
+        printf("  rss: +%5d KB", int((sample.peak_rss - sample.base_rss) / 1024));
+    }
+    else
+    {
+        printf("  rss: %6d KB", int(sample.peak_rss / 1024));
+    }
+
+    if (sample.counters)
+    {
+        // every miss is a cache line from memory
+        double ipc = sample.cycles ? double(sample.instructions) / sample.cycles : 0.0;
+        printf("  cycles: %6d M  ipc: %4.2f  llc-miss: %6d K (%5d MB)",
+            int(sample.cycles / 1000000), ipc,
+            int(sample.cache_misses / 1000), int(sample.cache_misses * 64 / (1024 * 1024)));
+    }
+
+    printf("\n");
+
+    instrument::begin();
+}
+
 void print(const char* name, const char* comment, u64 time0, u64 time1, u64 time2, size_t size)
 {
     u64 encode = time1 - time0;
@@ -17,6 +54,11 @@ void print(const char* name, const char* comment, u64 time0, u64 time1, u64 time
         int(encode / 1000), int(encode % 1000) / 100,
         int(decode / 1000), int(decode % 1000) / 100,
         int(size / 1024), comment);
+
+    if (g_stats)
+    {
+        print_stats();
+    }
 }
 
 void test_qoi(const char* name, Surface s)
@@ -38,7 +80,30 @@ void test_qoi(const char* name, Surface s)
     temp.save("result.png");
 #endif
 
-    free(encode_ptr);
+    delete[] encode_ptr;
+
+    u64 time2 = Time::us();
+    print(name, "", time0, time1, time2, length);
+}
+
+void test_qoi_convert(const char* name, Surface s, const Format& format, bool premultiply)
+{
+    u64 time0 = Time::us();
+
+    size_t length;
+    u8* encode_ptr = qoi_encode(s.image, s.stride, s.width, s.height, &length);
+
+    u64 time1 = Time::us();
+
+    // decode and convert in one pass
+    Bitmap temp(s.width, s.height, format);
+    qoi_decode_surface(temp, encode_ptr, length, premultiply);
+
+#if 0
+    temp.save("result.png");
+#endif
+
+    delete[] encode_ptr;
 
     u64 time2 = Time::us();
     print(name, "", time0, time1, time2, length);
@@ -71,24 +136,63 @@ void test_qoi_zstd(const char* name, Surface s)
     temp.save("result.png");
 #endif
 
-    free(encode_ptr);
+    delete[] encode_ptr;
 
     u64 time2 = Time::us();
     print(name, "", time0, time1, time2, size);
 }
 
-void test_qoi_tile(const char* name, Surface s)
+struct TileConfig
 {
-    u64 time0 = Time::us();
+    int width;  // tile dimensions
+    int height;
+    int grain;  // horizontally adjacent tiles per task
+};
+
+// Larger tiles compress better and fewer tasks cost less to schedule, but there must
+// be enough tasks to keep every core busy until the end.
+TileConfig choose_tile_config(int width, int height, int cores)
+{
+    constexpr int min_task_pixels = 64 * 1024; // amortizes the per-task overhead
+    constexpr int tasks_per_core = 4;          // slack for load balancing
 
-#if 1
-    constexpr u32 tile = 64;
-#else
-    constexpr u32 tile = 64000;
-#endif
+    int pixels = width * height;
+    int tasks = std::clamp(pixels / min_task_pixels, 1, cores * tasks_per_core);
+
+    if (tasks == 1)
+    {
+        return { width, height, 1 };
+    }
+
+    int tile = 256;
+    while (tile > 64 && div_ceil(width, tile) * div_ceil(height, tile) < tasks)
+    {
+        tile /= 2;
+    }
+
+    int xs = div_ceil(width, tile);
+    int ys = div_ceil(height, tile);
+    int grain = std::clamp(xs * ys / tasks, 1, xs);
+
+    return { tile, tile, grain };
+}
 
-    const int xs = div_ceil(s.width, tile);
-    const int ys = div_ceil(s.height, tile);
+struct TileResult
+{
+    u64 encode;
+    u64 decode;
+    size_t size;
+};
+
+TileResult run_qoi_tile(Surface s, const TileConfig& config)
+{
+    u64 time0 = Time::us();
+
+    const int tw = config.width;
+    const int th = config.height;
+    const int xs = div_ceil(s.width, tw);
+    const int ys = div_ceil(s.height, th);
+    const int grain = std::clamp(config.grain, 1, xs);
 
     std::vector<Memory> encode_memory(xs * ys);
 
@@ -96,16 +200,20 @@ void test_qoi_tile(const char* name, Surface s)
 
     for (int y = 0; y < ys; ++y)
     {
-        for (int x = 0; x < xs; ++x)
+        for (int x0 = 0; x0 < xs; x0 += grain)
         {
-            Surface rect(s, x * tile, y * tile, tile, tile);
-            int idx = y * xs + x;
+            int x1 = std::min(x0 + grain, xs);
 
-            q.enqueue([rect, idx, &encode_memory]
+            q.enqueue([s, x0, x1, y, xs, tw, th, &encode_memory]
             {
-                size_t length;
-                u8* encode_ptr = qoi_encode(rect.image, rect.stride, rect.width, rect.height, &length);
-                encode_memory[idx] = Memory(encode_ptr, length);
+                for (int x = x0; x < x1; ++x)
+                {
+                    Surface rect(s, x * tw, y * th, tw, th);
+
+                    size_t length;
+                    u8* encode_ptr = qoi_encode(rect.image, rect.stride, rect.width, rect.height, &length);
+                    encode_memory[y * xs + x] = Memory(encode_ptr, length);
+                }
             });
         }
     }
@@ -124,20 +232,22 @@ void test_qoi_tile(const char* name, Surface s)
 
     for (int y = 0; y < ys; ++y)
     {
-        for (int x = 0; x < xs; ++x)
+        for (int x0 = 0; x0 < xs; x0 += grain)
         {
-            Surface rect(temp, x * tile, y * tile, tile, tile);
-            int idx = y * xs + x;
+            int x1 = std::min(x0 + grain, xs);
+            Surface dest = temp;
 
-            q.enqueue([rect, idx, &encode_memory]
+            q.enqueue([dest, x0, x1, y, xs, tw, th, &encode_memory]
             {
-                int w = rect.width;
-                int h = rect.height;
-                Memory memory = encode_memory[idx];
+                for (int x = x0; x < x1; ++x)
+                {
+                    Surface rect(dest, x * tw, y * th, tw, th);
+                    Memory memory = encode_memory[y * xs + x];
 
-                qoi_decode(rect.image, memory.address, memory.size, w, h, rect.stride);
+                    qoi_decode(rect.image, memory.address, memory.size, rect.width, rect.height, rect.stride);
 
-                free(memory.address);
+                    delete[] memory.address;
+                }
             });
         }
     }
@@ -148,10 +258,271 @@ void test_qoi_tile(const char* name, Surface s)
     temp.save("result.png");
 #endif
 
+    u64 time2 = Time::us();
+
+    return { time1 - time0, time2 - time1, size };
+}
+
+void test_qoi_tile(const char* name, Surface s)
+{
+    int cores = std::max(1, int(std::thread::hardware_concurrency()));
+    TileConfig config = choose_tile_config(s.width, s.height, cores);
+
+    TileResult result = run_qoi_tile(s, config);
+    print(name, "", 0, result.encode, result.encode + result.decode, result.size);
+}
+
+void tune_qoi_tile(Surface s)
+{
+    int cores = std::max(1, int(std::thread::hardware_concurrency()));
+    TileConfig best = choose_tile_config(s.width, s.height, cores);
+
+    std::vector<TileConfig> configs;
+
+    for (int tile : { 32, 64, 128, 256, 512 })
+    {
+        int xs = div_ceil(s.width, tile);
+        for (int grain : { 1, 2, 4, 8 })
+        {
+            if (grain < xs)
+            {
+                configs.push_back({ tile, tile, grain });
+            }
+        }
+
+        configs.push_back({ tile, tile, xs }); // row of tiles per task
+    }
+
+    configs.push_back({ s.width, 64, 1 }); // full width bands
+    configs.push_back(best);
+
+    std::vector<TileResult> results;
+
+    for (const TileConfig& config : configs)
+    {
+        TileResult result = { ~0ull, ~0ull, 0 };
+
+        // best of three
+        for (int i = 0; i < 3; ++i)
+        {
+            TileResult r = run_qoi_tile(s, config);
+            result.encode = std::min(result.encode, r.encode);
+            result.decode = std::min(result.decode, r.decode);
+            result.size = r.size;
+        }
+
+        results.push_back(result);
+    }
+
+    const double bytes = double(s.width) * s.height * 4;
+
+    printf("\n");
+    printf("tile tuning: %d cores, auto: %dx%d, grain %d\n", cores, best.width, best.height, best.grain);
+    printf("----------------------------------------------------------------------\n");
+    printf("  tile        grain  tasks  encode(MB/s)  decode(MB/s)  ratio   \n");
+    printf("----------------------------------------------------------------------\n");
+
+    for (size_t i = 0; i < configs.size(); ++i)
+    {
+        const TileConfig& config = configs[i];
+        const TileResult& result = results[i];
+
+        // frontier: no other configuration is both smaller and faster to decode
+        bool frontier = true;
+        for (const TileResult& other : results)
+        {
+            if (other.size <= result.size && other.decode <= result.decode &&
+                (other.size < result.size || other.decode < result.decode))
+            {
+                frontier = false;
+            }
+        }
+
+        int xs = div_ceil(s.width, config.width);
+        int ys = div_ceil(s.height, config.height);
+        int tasks = div_ceil(xs, config.grain) * ys;
+
+        printf("  %4d x %-4d  %5d  %5d  %12.1f  %12.1f  %5.3f  %s%s\n",
+            config.width, config.height, config.grain, tasks,
+            bytes / std::max(result.encode, u64(1)),
+            bytes / std::max(result.decode, u64(1)),
+            double(result.size) / bytes,
+            frontier ? "*" : "",
+            i == configs.size() - 1 ? " (auto)" : "");
+    }
+}
+
+void test_qoi_restart(const char* name, Surface s)
+{
+    u64 time0 = Time::us();
+
+    constexpr int interval = 64;
+
+    size_t length;
+    u8* encode_ptr = qoi_encode_restart(s.image, s.stride, s.width, s.height, interval, &length);
+
+    u64 time1 = Time::us();
+
+    int w = s.width;
+    int h = s.height;
+    Bitmap temp(w, h, s.format);
+
+    std::vector<u32> offsets(div_ceil(h, interval));
+    int count = qoi_restart_table(encode_ptr, length, offsets.data(), int(offsets.size()), nullptr);
+    count = std::min(count, int(offsets.size()));
+
+    ConcurrentQueue q;
+
+    for (int i = 0; i < count; ++i)
+    {
+        int y = i * interval;
+        Surface band(temp, 0, y, w, interval);
+        u32 offset = offsets[i];
+
+        q.enqueue([band, encode_ptr, length, offset]
+        {
+            qoi_decode(band.image, encode_ptr + offset, length - offset, band.width, band.height, band.stride);
+        });
+    }
+
+    q.wait();
+
+#if 0
+    temp.save("result.png");
+#endif
+
+    delete[] encode_ptr;
+
+    u64 time2 = Time::us();
+
+    bool match = count == int(offsets.size());
+
+    for (int y = 0; match && y < h; ++y)
+    {
+        match = !std::memcmp(s.image + y * s.stride, temp.image + y * temp.stride, w * 4);
+    }
+
+    const char* comment = !match ? "<-- mismatch" : "";
+    print(name, comment, time0, time1, time2, length);
+}
+
+// Cut the image into sprites from 16x16 to 128x128 pixels.
+std::vector<Surface> make_sprites(Surface s)
+{
+    std::vector<Surface> sprites;
+
+    const int sizes [] = { 16, 32, 64, 128 };
+
+    for (int y = 0, row = 0; y < s.height; y += sizes[row % 4], ++row)
+    {
+        int size = sizes[row % 4];
+        for (int x = 0; x < s.width; x += size)
+        {
+            sprites.emplace_back(s, x, y, size, size);
+        }
+    }
+
+    return sprites;
+}
+
+void test_qoi_sprites(const char* name, Surface s)
+{
+    std::vector<Surface> sprites = make_sprites(s);
+    std::vector<Memory> encode_memory(sprites.size());
+
+    u64 time0 = Time::us();
+
+    ConcurrentQueue q;
+
+    for (size_t i = 0; i < sprites.size(); ++i)
+    {
+        Surface sprite = sprites[i];
+        q.enqueue([sprite, i, &encode_memory]
+        {
+            size_t length;
+            u8* encode_ptr = qoi_encode(sprite.image, sprite.stride, sprite.width, sprite.height, &length);
+            encode_memory[i] = Memory(encode_ptr, length);
+        });
+    }
+
+    q.wait();
+
+    size_t size = 0;
+    for (auto memory : encode_memory)
+    {
+        size += memory.size;
+    }
+
+    u64 time1 = Time::us();
+
+    Bitmap temp(s.width, s.height, s.format);
+    std::vector<Surface> dest = make_sprites(temp);
+
+    for (size_t i = 0; i < dest.size(); ++i)
+    {
+        Surface sprite = dest[i];
+        q.enqueue([sprite, i, &encode_memory]
+        {
+            Memory memory = encode_memory[i];
+            qoi_decode(sprite.image, memory.address, memory.size, sprite.width, sprite.height, sprite.stride);
+            delete[] memory.address;
+        });
+    }
+
+    q.wait();
+
     u64 time2 = Time::us();
     print(name, "", time0, time1, time2, size);
 }
 
+void test_qoi_batch(const char* name, Surface s)
+{
+    std::vector<Surface> sprites = make_sprites(s);
+
+    u64 time0 = Time::us();
+
+    QOIBatch batch;
+    qoi_encode_batch(batch, sprites.data(), sprites.size());
+
+    u64 time1 = Time::us();
+
+    Bitmap temp(s.width, s.height, s.format);
+    std::vector<Surface> dest = make_sprites(temp);
+
+    qoi_decode_batch(dest.data(), dest.size(), batch);
+
+#if 0
+    temp.save("result.png");
+#endif
+
+    u64 time2 = Time::us();
+    print(name, "", time0, time1, time2, batch.arena.size());
+}
+
+void test_qoi_file(const char* name, Surface s)
+{
+    const char* filename = "qoitest_output.qoi";
+
+    u64 time0 = Time::us();
+
+    qoi_write(filename, s.image, s.stride, s.width, s.height);
+
+    u64 time1 = Time::us();
+
+    {
+        QOIFile file(filename);
+
+        Bitmap temp(int(file.desc().width), int(file.desc().height), s.format);
+        file.decode(temp);
+    }
+
+    u64 time2 = Time::us();
+
+    size_t size = size_t(filesystem::File(filename).size());
+    std::remove(filename);
+    print(name, "<-- mapped file", time0, time1, time2, size);
+}
+
 void test_zstd(const char* name, Surface s)
 {
     u64 time0 = Time::us();
@@ -188,6 +559,99 @@ void test_lz4(const char* name, Surface s)
     print(name, "", time0, time1, time2, size);
 }
 
+void test_lzo(const char* name, Surface s)
+{
+    u64 time0 = Time::us();
+
+    ConstMemory memory(s.image, s.width * s.height * 4);
+    size_t bound = lzo::bound(memory.size);
+    Buffer compressed(bound);
+    size_t size = lzo::compress(compressed, memory, 6);
+
+    u64 time1 = Time::us();
+
+    Buffer decompressed(memory.size);
+    lzo::decompress(decompressed, ConstMemory(compressed.data(), size));
+
+    u64 time2 = Time::us();
+    print(name, "", time0, time1, time2, size);
+}
+
+void test_shuffle_zstd(const char* name, Surface s, bool delta)
+{
+    u64 time0 = Time::us();
+
+    const size_t count = s.width * s.height;
+    Buffer filtered(count * 4);
+    prefilter::encode(filtered.data(), s.image, count, delta);
+
+    ConstMemory memory = filtered;
+    size_t bound = zstd::bound(memory.size);
+    Buffer compressed(bound);
+    size_t size = zstd::compress(compressed, memory, 2);
+
+    u64 time1 = Time::us();
+
+    Buffer decompressed(memory.size);
+    zstd::decompress(decompressed, ConstMemory(compressed.data(), size));
+
+    Buffer pixels(memory.size);
+    prefilter::decode(pixels.data(), decompressed.data(), count, delta);
+
+    u64 time2 = Time::us();
+    print(name, "", time0, time1, time2, size);
+}
+
+void test_shuffle_lz4(const char* name, Surface s, bool delta)
+{
+    u64 time0 = Time::us();
+
+    const size_t count = s.width * s.height;
+    Buffer filtered(count * 4);
+    prefilter::encode(filtered.data(), s.image, count, delta);
+
+    ConstMemory memory = filtered;
+    size_t bound = lz4::bound(memory.size);
+    Buffer compressed(bound);
+    size_t size = lz4::compress(compressed, memory, 6);
+
+    u64 time1 = Time::us();
+
+    Buffer decompressed(memory.size);
+    lz4::decompress(decompressed, ConstMemory(compressed.data(), size));
+
+    Buffer pixels(memory.size);
+    prefilter::decode(pixels.data(), decompressed.data(), count, delta);
+
+    u64 time2 = Time::us();
+    print(name, "", time0, time1, time2, size);
+}
+
+void test_shuffle_lzo(const char* name, Surface s, bool delta)
+{
+    u64 time0 = Time::us();
+
+    const size_t count = s.width * s.height;
+    Buffer filtered(count * 4);
+    prefilter::encode(filtered.data(), s.image, count, delta);
+
+    ConstMemory memory = filtered;
+    size_t bound = lzo::bound(memory.size);
+    Buffer compressed(bound);
+    size_t size = lzo::compress(compressed, memory, 6);
+
+    u64 time1 = Time::us();
+
+    Buffer decompressed(memory.size);
+    lzo::decompress(decompressed, ConstMemory(compressed.data(), size));
+
+    Buffer pixels(memory.size);
+    prefilter::decode(pixels.data(), decompressed.data(), count, delta);
+
+    u64 time2 = Time::us();
+    print(name, "", time0, time1, time2, size);
+}
+
 void test_format(const char* name, Surface s, const std::string& extension, bool lossless)
 {
     u64 time0 = Time::us();
@@ -215,32 +679,152 @@ void test_format(const char* name, Surface s, const std::string& extension, bool
     ::print(name, comment, time0, time1, time2, output.size());
 }
 
+// Decode the source file and encode into a QOI restart stream, either one stage after
+// the other or pipelined band by band. s is the source decoded in advance; the result
+// is decoded and compared against it.
+void test_transcode(const char* name, const std::string& filename, Surface s, bool pipelined)
+{
+    constexpr int interval = 64;
+
+    filesystem::File file(filename);
+
+    u64 time0 = Time::us();
+
+    std::vector<u8> output;
+
+    if (pipelined)
+    {
+        output = transcode::to_qoi(file, filename, interval);
+    }
+    else
+    {
+        Bitmap bitmap(file, filename, Format(32, Format::UNORM, Format::RGBA, 8, 8, 8, 8));
+
+        size_t length;
+        u8* data = qoi_encode_restart(bitmap.image, bitmap.stride, bitmap.width, bitmap.height, interval, &length);
+        output.assign(data, data + length);
+        delete[] data;
+    }
+
+    u64 time1 = Time::us();
+
+    Bitmap temp(s.width, s.height, s.format);
+    qoi_decode(temp.image, output.data(), output.size(), temp.width, temp.height, temp.stride);
+
+    u64 time2 = Time::us();
+
+    bool match = true;
+    for (int y = 0; y < s.height; ++y)
+    {
+        match = match && !std::memcmp(s.image + y * s.stride, temp.image + y * temp.stride, s.width * 4);
+    }
+
+    const char* comment = !match ? "<-- mismatch" : pipelined ? "<-- source > qoi, pipelined" : "<-- source > qoi";
+    print(name, comment, time0, time1, time2, output.size());
+}
+
+void test_select(Surface s)
+{
+    u64 time0 = Time::us();
+    std::vector<codec::Estimate> estimates = codec::estimate(s);
+    u64 time1 = Time::us();
+
+    printf("\n");
+    printf("sampled estimate (%d.%d ms)\n", int((time1 - time0) / 1000), int((time1 - time0) % 1000) / 100);
+    printf("----------------------------------------------\n");
+    printf("           ratio   encode(MB/s)  decode(MB/s) \n");
+    printf("----------------------------------------------\n");
+
+    for (const auto& estimate : estimates)
+    {
+        printf("%-9s  %5.1f%%  %10d    %10d\n", codec::getName(estimate.codec),
+            estimate.ratio * 100.0, int(estimate.encode_mbps), int(estimate.decode_mbps));
+    }
+
+    codec::Target smallest;
+
+    codec::Target fast;
+    fast.min_decode_mbps = 1000.0;
+
+    codec::Target compact;
+    compact.max_ratio = 0.5;
+    compact.min_decode_mbps = 300.0;
+
+    printf("----------------------------------------------\n");
+    printf("smallest:              %s\n", codec::getName(codec::select(estimates, smallest).codec));
+    printf("decode >= 1000 MB/s:   %s\n", codec::getName(codec::select(estimates, fast).codec));
+    printf("50%% at >= 300 MB/s:    %s\n", codec::getName(codec::select(estimates, compact).codec));
+}
+
 int main(int argc, const char* argv[])
 {
     if (argc < 2)
     {
-        printf("Too few arguments. usage: <filename.jpg>\n");
+        printf("Too few arguments. usage: <filename.jpg> [--tune | --stats]\n");
         exit(1);
     }
 
     std::string filename = argv[1];
+    std::string option = argc > 2 ? argv[2] : "";
+    g_stats = option == "--stats";
+
+    // the hardware counters follow only the threads started after they are opened,
+    // so they are opened before the image decoder starts the thread pool
+    bool counters = g_stats && instrument::counters();
+
     Bitmap bitmap(filename, Format(32, Format::UNORM, Format::RGBA, 8, 8, 8, 8));
 
+    if (option == "--tune")
+    {
+        tune_qoi_tile(bitmap);
+        return 0;
+    }
+
     printf("\n");
     printf("image: %d x %d (%6d KB )\n", bitmap.width, bitmap.height, int(bitmap.width * bitmap.height * 4 / 1024));
+    printf("prefilter: %s\n", prefilter::kernel());
+
+    if (g_stats)
+    {
+        printf("stats: allocations: %s, hardware counters: %s\n", instrument::allocator(),
+            counters ? "all threads" : "not available");
+    }
+
     printf("----------------------------------------------\n");
     printf("         encode(ms)  decode(ms)   size(KB)    \n");
     printf("----------------------------------------------\n");
 
-    test_qoi     ("qoi:      ", bitmap);
-    test_qoi_zstd("qoi+zstd: ", bitmap);
-    test_qoi_tile("qoi+tile: ", bitmap);
-    test_zstd    ("zstd:     ", bitmap);
-    test_lz4     ("lz4:      ", bitmap);
-    test_format  ("png:      ", bitmap, ".png", true);
-    test_format  ("zpng:     ", bitmap, ".zpng", true);
-    test_format  ("jpg:      ", bitmap, ".jpg", false);
-    test_format  ("webp:     ", bitmap, ".webp", false);
-    test_format  ("qoi:      ", bitmap, ".qoi", true);
-    test_format  ("toi:      ", bitmap, ".toi", true);
+    if (g_stats)
+    {
+        instrument::begin();
+    }
+
+    test_qoi        ("qoi:      ", bitmap);
+    test_qoi_convert("qoi>bgra: ", bitmap, Format(32, Format::UNORM, Format::BGRA, 8, 8, 8, 8), true);
+    test_qoi_convert("qoi>565:  ", bitmap, Format(16, Format::UNORM, Format::BGR, 5, 6, 5, 0), false);
+    test_qoi_zstd   ("qoi+zstd: ", bitmap);
+    test_qoi_tile   ("qoi+tile: ", bitmap);
+    test_qoi_restart("qoi+rst:  ", bitmap);
+    test_qoi_sprites("sprites:  ", bitmap);
+    test_qoi_batch  ("batch:    ", bitmap);
+    test_qoi_file   ("qoi file: ", bitmap);
+    test_zstd       ("zstd:     ", bitmap);
+    test_lz4        ("lz4:      ", bitmap);
+    test_lzo        ("lzo:      ", bitmap);
+    test_shuffle_zstd("shuf+zstd:", bitmap, false);
+    test_shuffle_lz4 ("shuf+lz4: ", bitmap, false);
+    test_shuffle_lzo ("shuf+lzo: ", bitmap, false);
+    test_shuffle_zstd("dlt+zstd: ", bitmap, true);
+    test_shuffle_lz4 ("dlt+lz4:  ", bitmap, true);
+    test_shuffle_lzo ("dlt+lzo:  ", bitmap, true);
+    test_format     ("png:      ", bitmap, ".png", true);
+    test_format     ("zpng:     ", bitmap, ".zpng", true);
+    test_format     ("jpg:      ", bitmap, ".jpg", false);
+    test_format     ("webp:     ", bitmap, ".webp", false);
+    test_format     ("qoi:      ", bitmap, ".qoi", true);
+    test_format     ("toi:      ", bitmap, ".toi", true);
+    test_transcode  ("transcode:", filename, bitmap, false);
+    test_transcode  ("pipeline: ", filename, bitmap, true);
+
+    test_select(bitmap);
 }
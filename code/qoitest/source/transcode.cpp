@@ -0,0 +1,234 @@
+/*
+    MANGO Multimedia Development Platform
+    Copyright (C) 2012-2025 Twilight Finland 3D Oy Ltd. All rights reserved.
+*/
+#include <condition_variable>
+#include <mutex>
+#include "transcode.hpp"
+#include "qoi.h"
+
+#if defined(MANGO_PLATFORM_WINDOWS)
+    #include <windows.h>
+#else
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+namespace
+{
+    using namespace mango;
+    using namespace mango::image;
+
+    // ----------------------------------------------------------------------------
+    // Frame
+    // ----------------------------------------------------------------------------
+
+    // RGBA frame in reserved address space: pages become resident when the decoder
+    // writes them and release() hands them back to the system.
+
+    class Frame
+    {
+    protected:
+        u8* m_address = nullptr;
+        size_t m_size = 0;
+        size_t m_page = 4096;
+
+    public:
+        Surface surface;
+
+        Frame(int width, int height)
+        {
+            m_size = size_t(width) * height * 4;
+
+#if defined(MANGO_PLATFORM_WINDOWS)
+            SYSTEM_INFO info;
+            GetSystemInfo(&info);
+            m_page = info.dwPageSize;
+
+            // committed pages are not resident until they are touched
+            m_address = reinterpret_cast<u8*>(VirtualAlloc(nullptr, m_size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE));
+            if (!m_address)
+            {
+                MANGO_EXCEPTION("[transcode] Frame allocation failed.");
+            }
+#else
+            m_page = size_t(sysconf(_SC_PAGESIZE));
+
+            void* address = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+            if (address == MAP_FAILED)
+            {
+                MANGO_EXCEPTION("[transcode] Frame allocation failed.");
+            }
+            m_address = reinterpret_cast<u8*>(address);
+#endif
+
+            surface = Surface(width, height, Format(32, Format::UNORM, Format::RGBA, 8, 8, 8, 8), size_t(width) * 4, m_address);
+        }
+
+        ~Frame()
+        {
+#if defined(MANGO_PLATFORM_WINDOWS)
+            VirtualFree(m_address, 0, MEM_RELEASE);
+#else
+            munmap(m_address, m_size);
+#endif
+        }
+
+        Frame(const Frame&) = delete;
+        Frame& operator = (const Frame&) = delete;
+
+        // scanlines y0 .. y1 are no longer needed; only the pages which are completely
+        // inside the range are released as the neighbours may still be in use
+        void release(int y0, int y1)
+        {
+            uintptr_t begin = reinterpret_cast<uintptr_t>(m_address + y0 * surface.stride);
+            uintptr_t end = reinterpret_cast<uintptr_t>(m_address + y1 * surface.stride);
+
+            begin = (begin + m_page - 1) & ~uintptr_t(m_page - 1);
+            end = end & ~uintptr_t(m_page - 1);
+
+            if (begin < end)
+            {
+#if defined(MANGO_PLATFORM_WINDOWS)
+                VirtualFree(reinterpret_cast<void*>(begin), end - begin, MEM_DECOMMIT);
+#else
+                madvise(reinterpret_cast<void*>(begin), end - begin, MADV_DONTNEED);
+#endif
+            }
+        }
+    };
+
+} // namespace
+
+namespace transcode
+{
+    using namespace mango;
+    using namespace mango::image;
+
+    std::vector<u8> to_qoi(ConstMemory input, const std::string& filename, int interval, int max_bands, Stats* stats)
+    {
+        u64 time0 = Time::us();
+
+        ImageDecoder decoder(input, filename);
+        if (!decoder.isDecoder())
+        {
+            MANGO_EXCEPTION("[transcode] Unsupported image format.");
+        }
+
+        ImageHeader header = decoder.header();
+        if (!header.success)
+        {
+            MANGO_EXCEPTION("[transcode] Invalid image header.");
+        }
+
+        const int width = header.width;
+        const int height = header.height;
+
+        QOIRestartEncoder encoder(width, height, interval);
+        Frame frame(width, height);
+
+        const int bands = encoder.bands();
+        max_bands = std::max(max_bands, 1);
+
+        // pixels each band is still waiting for from the decoder
+        std::vector<s64> pending(bands);
+        std::vector<bool> queued(bands, false);
+
+        for (int i = 0; i < bands; ++i)
+        {
+            pending[i] = s64(width) * std::min(interval, height - i * interval);
+        }
+
+        std::mutex mutex;
+        std::condition_variable condition;
+        int complete = 0;
+        int released = 0;
+        int peak = 0;
+
+        ConcurrentQueue q;
+
+        // called with the mutex held
+        auto submit = [&] (int band)
+        {
+            queued[band] = true;
+            ++complete;
+            peak = std::max(peak, complete - released);
+
+            q.enqueue([&, band]
+            {
+                int y = band * interval;
+                int h = std::min(interval, height - y);
+
+                encoder.encode(band, frame.surface.image + y * frame.surface.stride, frame.surface.stride);
+                frame.release(y, y + h);
+
+                std::lock_guard<std::mutex> lock(mutex);
+                ++released;
+                condition.notify_one();
+            });
+        };
+
+        ImageDecodeOptions options;
+
+        // a single decoding thread reports the scanlines in order; the callback may
+        // then block without stalling decoder tasks which other bands depend on
+        options.multithread = false;
+
+        options.callback = [&] (const ImageDecodeRect& rect)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+
+            const int y1 = std::min(rect.y + rect.height, height);
+
+            for (int band = std::max(rect.y, 0) / interval; band < bands && band * interval < y1; ++band)
+            {
+                int top = std::max(rect.y, band * interval);
+                int bottom = std::min(y1, (band + 1) * interval);
+
+                pending[band] -= s64(bottom - top) * rect.width;
+
+                if (pending[band] <= 0 && !queued[band])
+                {
+                    submit(band);
+                }
+            }
+
+            // hold the decoder back until the encoders catch up
+            condition.wait(lock, [&] { return complete - released < max_bands; });
+        };
+
+        ImageDecodeStatus status = decoder.decode(frame.surface, options);
+
+        u64 time1 = Time::us();
+
+        {
+            // bands the decoder did not report
+            std::lock_guard<std::mutex> lock(mutex);
+
+            for (int band = 0; band < bands; ++band)
+            {
+                if (!queued[band] && status)
+                {
+                    submit(band);
+                }
+            }
+        }
+
+        q.wait();
+
+        if (!status)
+        {
+            MANGO_EXCEPTION("[transcode] Decoding failed.");
+        }
+
+        if (stats)
+        {
+            stats->decode = time1 - time0;
+            stats->bands = bands;
+            stats->peak_bands = peak;
+        }
+
+        return encoder.finish();
+    }
+
+} // namespace transcode
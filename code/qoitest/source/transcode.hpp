@@ -0,0 +1,40 @@
+/*
+    MANGO Multimedia Development Platform
+    Copyright (C) 2012-2025 Twilight Finland 3D Oy Ltd. All rights reserved.
+*/
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mango/mango.hpp>
+
+namespace transcode
+{
+    using mango::u8;
+    using mango::u64;
+    using mango::ConstMemory;
+
+    struct Stats
+    {
+        u64 decode = 0;      // microseconds until the source decoder returned
+        int bands = 0;
+        int peak_bands = 0;  // most bands decoded but not yet encoded at once
+    };
+
+    // Decodes a compressed image (the decoder is chosen by the filename extension) into
+    // a QOI restart stream, see qoi_encode_restart(), with interval scanlines per band.
+    //
+    // The decoder runs single threaded on the calling thread into a frame which is only
+    // reserved address space. Bands are encoded on the thread pool as soon as the
+    // decoder reports them through ImageDecodeOptions::callback and their pages are
+    // returned to the system once encoded; the decoder is held back while max_bands
+    // bands wait for encoding. The resident frame is a few bands instead of the full
+    // image and decoding overlaps with encoding.
+    //
+    // The decoder must write RGBA directly into the frame, which the JPEG decoder does.
+    // Decoders which do not report progress decode the whole frame before the encoding
+    // starts; the result is the same.
+
+    std::vector<u8> to_qoi(ConstMemory input, const std::string& filename, int interval = 64, int max_bands = 8, Stats* stats = nullptr);
+
+} // namespace transcode
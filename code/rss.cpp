@@ -0,0 +1,106 @@
+/*
+    MANGO Multimedia Development Platform
+    Copyright (C) 2012-2025 Twilight Finland 3D Oy Ltd. All rights reserved.
+*/
+#include "rss.hpp"
+
+#if defined(MANGO_PLATFORM_WINDOWS)
+    #include <windows.h>
+    #include <psapi.h>
+#elif defined(MANGO_PLATFORM_UNIX)
+    #include <cstdio>
+    #include <sys/resource.h>
+#endif
+
+using namespace mango;
+
+#if defined(MANGO_PLATFORM_WINDOWS)
+
+u64 getPeakRSS()
+{
+    PROCESS_MEMORY_COUNTERS counters;
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        return u64(counters.PeakWorkingSetSize);
+    }
+    return 0;
+}
+
+bool resetPeakRSS()
+{
+    return false;
+}
+
+#elif defined(MANGO_PLATFORM_LINUX)
+
+u64 getPeakRSS()
+{
+    // VmHWM reflects resetPeakRSS(), ru_maxrss does not
+    u64 peak = 0;
+
+    if (FILE* file = std::fopen("/proc/self/status", "r"))
+    {
+        char line[256];
+        while (std::fgets(line, sizeof(line), file))
+        {
+            unsigned long long kb;
+            if (std::sscanf(line, "VmHWM: %llu kB", &kb) == 1)
+            {
+                peak = u64(kb) * 1024;
+                break;
+            }
+        }
+        std::fclose(file);
+    }
+
+    return peak;
+}
+
+bool resetPeakRSS()
+{
+    // supported since Linux 4.0
+    bool status = false;
+
+    if (FILE* file = std::fopen("/proc/self/clear_refs", "w"))
+    {
+        status = std::fputs("5", file) >= 0;
+        status = (std::fclose(file) == 0) && status;
+    }
+
+    return status;
+}
+
+#elif defined(MANGO_PLATFORM_UNIX)
+
+u64 getPeakRSS()
+{
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == 0)
+    {
+#if defined(MANGO_PLATFORM_OSX)
+        return u64(usage.ru_maxrss); // bytes
+#else
+        return u64(usage.ru_maxrss) * 1024; // kilobytes
+#endif
+    }
+    return 0;
+}
+
+bool resetPeakRSS()
+{
+    return false;
+}
+
+#else
+
+u64 getPeakRSS()
+{
+    return 0;
+}
+
+bool resetPeakRSS()
+{
+    return false;
+}
+
+#endif
@@ -0,0 +1,14 @@
+/*
+    MANGO Multimedia Development Platform
+    Copyright (C) 2012-2025 Twilight Finland 3D Oy Ltd. All rights reserved.
+*/
+#pragma once
+
+#include <mango/mango.hpp>
+
+// Peak resident set size of the process in bytes, 0 when not available.
+mango::u64 getPeakRSS();
+
+// Reset the peak to the current resident set size so that it can be measured per test.
+// Returns false when the platform does not support it; the peak is then process-wide.
+bool resetPeakRSS();
@@ -0,0 +1,272 @@
+/*
+    MANGO Multimedia Development Platform
+    Copyright (C) 2012-2025 Twilight Finland 3D Oy Ltd. All rights reserved.
+*/
+#include <limits>
+#include <bzlib.h>
+#include "bzip2mt.hpp"
+
+namespace
+{
+    using namespace mango;
+
+    constexpr u64 BLOCK_MAGIC = 0x314159265359; // BCD pi
+    constexpr u64 END_MAGIC   = 0x177245385090; // BCD sqrt(pi)
+
+    struct Block
+    {
+        u64 start; // bit offset of the block magic
+        u64 end;   // bit offset of the next block or end of stream magic
+        std::vector<u8> output;
+        bool success = false;
+    };
+
+    class BitWriter
+    {
+    public:
+        std::vector<u8> data;
+        u64 buffer = 0;
+        int count = 0;
+
+        void write(u64 value, int bits)
+        {
+            // bits <= 32
+            buffer = (buffer << bits) | (value & ((u64(1) << bits) - 1));
+            count += bits;
+
+            while (count >= 8)
+            {
+                count -= 8;
+                data.push_back(u8(buffer >> count));
+            }
+        }
+
+        void flush()
+        {
+            if (count > 0)
+            {
+                data.push_back(u8(buffer << (8 - count)));
+                count = 0;
+            }
+        }
+    };
+
+    u32 readBits(const u8* data, u64 offset, int bits)
+    {
+        // bits <= 32, reads are within the stream since the scan found a complete magic
+        u32 value = 0;
+        for (int i = 0; i < bits; ++i)
+        {
+            u64 n = offset + i;
+            value = (value << 1) | ((data[n >> 3] >> (7 - (n & 7))) & 1);
+        }
+        return value;
+    }
+
+    void copyBits(BitWriter& writer, const u8* data, u64 start, u64 end)
+    {
+        // align to the source bytes, then copy whole bytes
+        while ((start & 7) && start < end)
+        {
+            writer.write(readBits(data, start, 1), 1);
+            ++start;
+        }
+
+        while (start + 8 <= end)
+        {
+            writer.write(data[start >> 3], 8);
+            start += 8;
+        }
+
+        if (start < end)
+        {
+            int bits = int(end - start);
+            writer.write(readBits(data, start, bits), bits);
+        }
+    }
+
+    // Single block stream: header, the block as-is, end of stream magic and the
+    // combined CRC, which for one block is the block CRC.
+    std::vector<u8> packBlock(const u8* data, const Block& block)
+    {
+        BitWriter writer;
+        writer.data.reserve(size_t((block.end - block.start) / 8 + 16));
+
+        writer.write('B', 8);
+        writer.write('Z', 8);
+        writer.write('h', 8);
+        writer.write('9', 8); // large enough for any block
+
+        copyBits(writer, data, block.start, block.end);
+
+        u32 crc = readBits(data, block.start + 48, 32);
+        writer.write(END_MAGIC >> 24, 24);
+        writer.write(END_MAGIC & 0xffffff, 24);
+        writer.write(crc, 32);
+        writer.flush();
+
+        return std::move(writer.data);
+    }
+
+    bool scanBlocks(std::vector<Block>& blocks, ConstMemory source)
+    {
+        const u8* data = source.address;
+        const size_t size = source.size;
+
+        // a complete magic needs 6 bytes and the window reads 8
+        for (size_t i = 4; i + 8 <= size; ++i)
+        {
+            const u64 window = bigEndian::uload64(data + i);
+
+            for (int k = 0; k < 8; ++k)
+            {
+                const u64 value = (window >> (16 - k)) & 0xffffffffffff;
+                const u64 offset = u64(i) * 8 + k;
+
+                if (value == BLOCK_MAGIC)
+                {
+                    if (!blocks.empty() && !blocks.back().end)
+                        blocks.back().end = offset;
+                    blocks.emplace_back();
+                    blocks.back().start = offset;
+                    blocks.back().end = 0;
+                }
+                else if (value == END_MAGIC)
+                {
+                    if (!blocks.empty() && !blocks.back().end)
+                        blocks.back().end = offset;
+                }
+            }
+        }
+
+        if (blocks.empty())
+            return false;
+
+        for (const Block& block : blocks)
+        {
+            if (!block.end)
+                return false;
+        }
+
+        return true;
+    }
+
+    bool decodeBlock(Block& block, const u8* data, size_t capacity)
+    {
+        std::vector<u8> packed = packBlock(data, block);
+
+        // libbzip2 buffer sizes are unsigned int; a single block never decodes that large
+        capacity = std::min(capacity, size_t(std::numeric_limits<unsigned int>::max()));
+
+        block.output.resize(capacity);
+        unsigned int length = unsigned(capacity);
+
+        int result = BZ2_bzBuffToBuffDecompress(
+            reinterpret_cast<char*>(block.output.data()), &length,
+            reinterpret_cast<char*>(packed.data()), unsigned(packed.size()), 0, 0);
+
+        block.success = (result == BZ_OK);
+        block.output.resize(block.success ? length : 0);
+
+        return block.success;
+    }
+
+    CompressionStatus decompressSerial(Memory dest, ConstMemory source)
+    {
+        CompressionStatus status;
+
+        // libbzip2 buffer sizes are unsigned int
+        constexpr size_t limit = std::numeric_limits<unsigned int>::max();
+        if (dest.size > limit || source.size > limit)
+        {
+            status.setError("[bzip2mt] stream is too large for serial decompression.");
+            return status;
+        }
+
+        unsigned int length = unsigned(dest.size);
+        int result = BZ2_bzBuffToBuffDecompress(
+            reinterpret_cast<char*>(dest.address), &length,
+            const_cast<char*>(reinterpret_cast<const char*>(source.address)), unsigned(source.size), 0, 0);
+
+        if (result != BZ_OK)
+        {
+            status.setError("[bzip2mt] decompression failed.");
+        }
+
+        status.size = length;
+        return status;
+    }
+
+} // namespace
+
+namespace bzip2mt
+{
+    using namespace mango;
+
+    CompressionStatus decompress(Memory dest, ConstMemory source)
+    {
+        if (source.size < 4 || std::memcmp(source.address, "BZh", 3))
+        {
+            CompressionStatus status;
+            status.setError("[bzip2mt] incorrect header.");
+            return status;
+        }
+
+        std::vector<Block> blocks;
+
+        if (!scanBlocks(blocks, source) || blocks.size() < 2)
+        {
+            return decompressSerial(dest, source);
+        }
+
+        // The block size limit applies before the initial run-length coding, so a block
+        // can decode larger than 900 KB; those are retried with the whole destination.
+        const size_t capacity = std::min(dest.size, size_t(900000 + 64 * 1024));
+
+        ConcurrentQueue q;
+
+        for (Block& block : blocks)
+        {
+            q.enqueue([&block, &source, &dest, capacity]
+            {
+                if (!decodeBlock(block, source.address, capacity) && capacity < dest.size)
+                {
+                    decodeBlock(block, source.address, dest.size);
+                }
+            });
+        }
+
+        q.wait();
+
+        size_t total = 0;
+
+        for (const Block& block : blocks)
+        {
+            if (!block.success)
+            {
+                return decompressSerial(dest, source);
+            }
+            total += block.output.size();
+        }
+
+        if (total > dest.size)
+        {
+            CompressionStatus status;
+            status.setError("[bzip2mt] destination is too small.");
+            return status;
+        }
+
+        u8* output = dest.address;
+
+        for (const Block& block : blocks)
+        {
+            std::memcpy(output, block.output.data(), block.output.size());
+            output += block.output.size();
+        }
+
+        CompressionStatus status;
+        status.size = total;
+        return status;
+    }
+
+} // namespace bzip2mt
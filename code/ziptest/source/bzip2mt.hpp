@@ -0,0 +1,23 @@
+/*
+    MANGO Multimedia Development Platform
+    Copyright (C) 2012-2025 Twilight Finland 3D Oy Ltd. All rights reserved.
+*/
+#pragma once
+
+#include <mango/mango.hpp>
+
+namespace bzip2mt
+{
+    using mango::Memory;
+    using mango::ConstMemory;
+    using mango::CompressionStatus;
+
+    // Decode a bzip2 stream with the blocks distributed over the thread pool.
+    //
+    // The blocks are located by scanning for the 48 bit block magic, which is not byte
+    // aligned, and each block is re-packed into a standalone single block stream. The
+    // block CRCs reject false positives from the scan; when anything goes wrong the
+    // stream is decoded serially. The destination must hold the whole decoded stream.
+    CompressionStatus decompress(Memory dest, ConstMemory source);
+
+} // namespace bzip2mt
@@ -0,0 +1,477 @@
+/*
+    MANGO Multimedia Development Platform
+    Copyright (C) 2012-2025 Twilight Finland 3D Oy Ltd. All rights reserved.
+*/
+#include "crc32.hpp"
+
+#if defined(MANGO_CPU_INTEL)
+    #include <immintrin.h>
+    #if defined(__GNUC__) || defined(__clang__)
+        #include <cpuid.h>
+        #define CRC32_TARGET_CLMUL __attribute__((target("sse4.1,pclmul")))
+        #define CRC32_TARGET_VPCLMUL __attribute__((target("avx2,pclmul,vpclmulqdq")))
+    #else
+        #include <intrin.h>
+        #define CRC32_TARGET_CLMUL
+        #define CRC32_TARGET_VPCLMUL
+    #endif
+#endif
+
+#if defined(__ARM_FEATURE_CRC32)
+    #include <arm_acle.h>
+#endif
+
+namespace
+{
+    using namespace mango;
+
+    using CrcFunc = u32 (*)(u32 crc, const u8* data, size_t size);
+
+    // ----------------------------------------------------------------------------
+    // generic
+    // ----------------------------------------------------------------------------
+
+    u32 crc32_generic(u32 crc, const u8* data, size_t size)
+    {
+        return mango::crc32(crc, ConstMemory(data, size));
+    }
+
+#if defined(MANGO_CPU_INTEL)
+
+    // ----------------------------------------------------------------------------
+    // pclmul
+    // ----------------------------------------------------------------------------
+
+    // "Fast CRC Computation for Generic Polynomials Using PCLMULQDQ Instruction"
+    // Four 128 bit lanes are folded 64 bytes at a time, then folded into one lane
+    // and Barrett reduced to 32 bits. The bit-reflected constants are for 0x04c11db7.
+
+    alignas(16) const u64 k1k2[] = { 0x0154442bd4, 0x01c6e41596 };
+    alignas(16) const u64 k3k4[] = { 0x01751997d0, 0x00ccaa009e };
+    alignas(16) const u64 k5k0[] = { 0x0163cd6124, 0x0000000000 };
+    alignas(16) const u64 poly[] = { 0x01db710641, 0x01f7011641 };
+
+    // Fold four consecutive lanes into one, then the remaining 16 byte blocks, and
+    // reduce to 32 bits.
+    CRC32_TARGET_CLMUL
+    inline u32 crc32_reduce(__m128i x1, __m128i x2, __m128i x3, __m128i x4, const u8* data, size_t size)
+    {
+        __m128i x0, x5;
+
+        // fold into 128 bits
+        x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(k3k4));
+
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x1 = _mm_xor_si128(x1, x2);
+        x1 = _mm_xor_si128(x1, x5);
+
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x1 = _mm_xor_si128(x1, x3);
+        x1 = _mm_xor_si128(x1, x5);
+
+        x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+        x1 = _mm_xor_si128(x1, x4);
+        x1 = _mm_xor_si128(x1, x5);
+
+        while (size >= 16)
+        {
+            x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+
+            x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+            x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+            x1 = _mm_xor_si128(x1, x2);
+            x1 = _mm_xor_si128(x1, x5);
+
+            data += 16;
+            size -= 16;
+        }
+
+        // fold 128 bits to 64 bits
+        x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+        x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+        x1 = _mm_srli_si128(x1, 8);
+        x1 = _mm_xor_si128(x1, x2);
+
+        x0 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(k5k0));
+
+        x2 = _mm_srli_si128(x1, 4);
+        x1 = _mm_and_si128(x1, x3);
+        x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+        x1 = _mm_xor_si128(x1, x2);
+
+        // Barrett reduction to 32 bits
+        x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(poly));
+
+        x2 = _mm_and_si128(x1, x3);
+        x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+        x2 = _mm_and_si128(x2, x3);
+        x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+        x1 = _mm_xor_si128(x1, x2);
+
+        return u32(_mm_extract_epi32(x1, 1));
+    }
+
+    CRC32_TARGET_CLMUL
+    u32 crc32_fold(u32 crc, const u8* data, size_t size)
+    {
+        // size must be at least 64 and a multiple of 16; crc is not inverted
+        __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+
+        x1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x00));
+        x2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x10));
+        x3 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x20));
+        x4 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x30));
+        x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128(int(crc)));
+
+        x0 = _mm_load_si128(reinterpret_cast<const __m128i*>(k1k2));
+
+        data += 64;
+        size -= 64;
+
+        while (size >= 64)
+        {
+            x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+            x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+            x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+            x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+
+            x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+            x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+            x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+            x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+
+            x1 = _mm_xor_si128(x1, x5);
+            x2 = _mm_xor_si128(x2, x6);
+            x3 = _mm_xor_si128(x3, x7);
+            x4 = _mm_xor_si128(x4, x8);
+
+            x1 = _mm_xor_si128(x1, _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x00)));
+            x2 = _mm_xor_si128(x2, _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x10)));
+            x3 = _mm_xor_si128(x3, _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x20)));
+            x4 = _mm_xor_si128(x4, _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 0x30)));
+
+            data += 64;
+            size -= 64;
+        }
+
+        return crc32_reduce(x1, x2, x3, x4, data, size);
+    }
+
+    u32 crc32_clmul(u32 crc, const u8* data, size_t size)
+    {
+        if (size >= 64)
+        {
+            size_t bytes = size & ~size_t(15);
+            crc = ~crc32_fold(~crc, data, bytes);
+            data += bytes;
+            size -= bytes;
+        }
+
+        if (size)
+        {
+            crc = crc32_generic(crc, data, size);
+        }
+
+        return crc;
+    }
+
+    // ----------------------------------------------------------------------------
+    // vpclmulqdq
+    // ----------------------------------------------------------------------------
+
+    // Same folding with two lanes per 256 bit register: eight lanes are folded 128 bytes
+    // at a time, then folded into four lanes for the 128 bit reduction.
+
+    alignas(32) const u64 k1k2_1024[] = { 0x01e88ef372, 0x014a7fe880, 0x01e88ef372, 0x014a7fe880 };
+
+    bool hasVPCLMULQDQ()
+    {
+        // CPUID leaf 7, ECX bit 10; the AVX2 check covers the OS support for ymm state
+#if defined(__GNUC__) || defined(__clang__)
+        unsigned int eax, ebx, ecx, edx;
+        if (!__get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx))
+            return false;
+        return (ecx >> 10) & 1;
+#else
+        int info[4];
+        __cpuidex(info, 7, 0);
+        return (info[2] >> 10) & 1;
+#endif
+    }
+
+    CRC32_TARGET_VPCLMUL
+    u32 crc32_fold_vpclmul(u32 crc, const u8* data, size_t size)
+    {
+        // size must be at least 128 and a multiple of 16; crc is not inverted
+        __m256i y0, y1, y2, y3, y4, y5, y6, y7, y8;
+
+        y1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + 0x00));
+        y2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + 0x20));
+        y3 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + 0x40));
+        y4 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + 0x60));
+        y1 = _mm256_xor_si256(y1, _mm256_setr_epi32(int(crc), 0, 0, 0, 0, 0, 0, 0));
+
+        y0 = _mm256_load_si256(reinterpret_cast<const __m256i*>(k1k2_1024));
+
+        data += 128;
+        size -= 128;
+
+        while (size >= 128)
+        {
+            y5 = _mm256_clmulepi64_epi128(y1, y0, 0x00);
+            y6 = _mm256_clmulepi64_epi128(y2, y0, 0x00);
+            y7 = _mm256_clmulepi64_epi128(y3, y0, 0x00);
+            y8 = _mm256_clmulepi64_epi128(y4, y0, 0x00);
+
+            y1 = _mm256_clmulepi64_epi128(y1, y0, 0x11);
+            y2 = _mm256_clmulepi64_epi128(y2, y0, 0x11);
+            y3 = _mm256_clmulepi64_epi128(y3, y0, 0x11);
+            y4 = _mm256_clmulepi64_epi128(y4, y0, 0x11);
+
+            y1 = _mm256_xor_si256(y1, y5);
+            y2 = _mm256_xor_si256(y2, y6);
+            y3 = _mm256_xor_si256(y3, y7);
+            y4 = _mm256_xor_si256(y4, y8);
+
+            y1 = _mm256_xor_si256(y1, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + 0x00)));
+            y2 = _mm256_xor_si256(y2, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + 0x20)));
+            y3 = _mm256_xor_si256(y3, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + 0x40)));
+            y4 = _mm256_xor_si256(y4, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + 0x60)));
+
+            data += 128;
+            size -= 128;
+        }
+
+        // fold the first 64 bytes into the last 64 bytes
+        y0 = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(k1k2)));
+
+        y5 = _mm256_clmulepi64_epi128(y1, y0, 0x00);
+        y6 = _mm256_clmulepi64_epi128(y2, y0, 0x00);
+        y1 = _mm256_clmulepi64_epi128(y1, y0, 0x11);
+        y2 = _mm256_clmulepi64_epi128(y2, y0, 0x11);
+        y3 = _mm256_xor_si256(y3, _mm256_xor_si256(y1, y5));
+        y4 = _mm256_xor_si256(y4, _mm256_xor_si256(y2, y6));
+
+        return crc32_reduce(_mm256_castsi256_si128(y3), _mm256_extracti128_si256(y3, 1),
+                            _mm256_castsi256_si128(y4), _mm256_extracti128_si256(y4, 1), data, size);
+    }
+
+    u32 crc32_vpclmul(u32 crc, const u8* data, size_t size)
+    {
+        if (size >= 128)
+        {
+            size_t bytes = size & ~size_t(15);
+            crc = ~crc32_fold_vpclmul(~crc, data, bytes);
+            data += bytes;
+            size -= bytes;
+        }
+
+        return crc32_clmul(crc, data, size);
+    }
+
+#endif // defined(MANGO_CPU_INTEL)
+
+#if defined(__ARM_FEATURE_CRC32)
+
+    // ----------------------------------------------------------------------------
+    // armv8 crc
+    // ----------------------------------------------------------------------------
+
+    u32 crc32_arm(u32 crc, const u8* data, size_t size)
+    {
+        crc = ~crc;
+
+        for ( ; size >= 32; size -= 32)
+        {
+            crc = __crc32d(crc, littleEndian::uload64(data +  0));
+            crc = __crc32d(crc, littleEndian::uload64(data +  8));
+            crc = __crc32d(crc, littleEndian::uload64(data + 16));
+            crc = __crc32d(crc, littleEndian::uload64(data + 24));
+            data += 32;
+        }
+
+        for ( ; size >= 8; size -= 8)
+        {
+            crc = __crc32d(crc, littleEndian::uload64(data));
+            data += 8;
+        }
+
+        for ( ; size > 0; --size)
+        {
+            crc = __crc32b(crc, *data++);
+        }
+
+        return ~crc;
+    }
+
+#endif // defined(__ARM_FEATURE_CRC32)
+
+    // ----------------------------------------------------------------------------
+    // kernel selection
+    // ----------------------------------------------------------------------------
+
+    struct CrcKernel
+    {
+        CrcFunc func;
+        const char* name;
+    };
+
+    CrcKernel selectKernel()
+    {
+        CrcKernel kernel = { crc32_generic, "generic" };
+
+#if defined(MANGO_CPU_INTEL)
+        u64 flags = getCPUFlags();
+        if ((flags & INTEL_CLMUL) && (flags & INTEL_SSE4_1))
+        {
+            kernel = { crc32_clmul, "pclmul" };
+
+            if ((flags & INTEL_AVX2) && hasVPCLMULQDQ())
+            {
+                kernel = { crc32_vpclmul, "vpclmulqdq" };
+            }
+        }
+#endif
+
+#if defined(__ARM_FEATURE_CRC32)
+        kernel = { crc32_arm, "armv8-crc" };
+#endif
+
+        return kernel;
+    }
+
+    const CrcKernel& getKernel()
+    {
+        static CrcKernel kernel = selectKernel();
+        return kernel;
+    }
+
+    // ----------------------------------------------------------------------------
+    // combine
+    // ----------------------------------------------------------------------------
+
+    // Polynomial arithmetic modulo the reflected CRC32 polynomial, as in zlib:
+    // crc32(A + B) = crc32(A) * x^(8 * sizeof(B)) + crc32(B)
+
+    constexpr u32 POLY = 0xedb88320;
+
+    constexpr u32 multmodp(u32 a, u32 b)
+    {
+        u32 m = u32(1) << 31;
+        u32 p = 0;
+
+        for (;;)
+        {
+            if (a & m)
+            {
+                p ^= b;
+                if ((a & (m - 1)) == 0)
+                    break;
+            }
+            m >>= 1;
+            b = b & 1 ? (b >> 1) ^ POLY : b >> 1;
+        }
+
+        return p;
+    }
+
+    struct PowerTable
+    {
+        // x^(2^n) mod p
+        u32 data[32];
+
+        constexpr PowerTable()
+            : data {}
+        {
+            u32 p = u32(1) << 30; // x^1
+            for (int n = 0; n < 32; ++n)
+            {
+                data[n] = p;
+                p = multmodp(p, p);
+            }
+        }
+    };
+
+    constexpr PowerTable g_power_table;
+
+    // x^(n * 2^k) mod p
+    u32 x2nmodp(u64 n, int k)
+    {
+        u32 p = u32(1) << 31; // x^0
+
+        while (n)
+        {
+            if (n & 1)
+            {
+                p = multmodp(g_power_table.data[k & 31], p);
+            }
+            n >>= 1;
+            ++k;
+        }
+
+        return p;
+    }
+
+} // namespace
+
+namespace fastcrc
+{
+    using namespace mango;
+
+    u32 crc32(u32 crc, ConstMemory memory)
+    {
+        return getKernel().func(crc, memory.address, memory.size);
+    }
+
+    u32 crc32_combine(u32 crc0, u32 crc1, u64 length1)
+    {
+        return multmodp(x2nmodp(length1, 3), crc0) ^ crc1;
+    }
+
+    u32 crc32_parallel(u32 crc, ConstMemory memory, size_t blocksize)
+    {
+        blocksize = std::max(blocksize, size_t(64 * 1024));
+
+        const size_t count = (memory.size + blocksize - 1) / blocksize;
+        if (count < 2)
+        {
+            return fastcrc::crc32(crc, memory);
+        }
+
+        std::vector<u32> partial(count);
+
+        ConcurrentQueue q;
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            size_t offset = i * blocksize;
+            size_t size = std::min(blocksize, memory.size - offset);
+            ConstMemory block(memory.address + offset, size);
+
+            q.enqueue([block, i, &partial]
+            {
+                partial[i] = fastcrc::crc32(0, block);
+            });
+        }
+
+        q.wait();
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            size_t offset = i * blocksize;
+            size_t size = std::min(blocksize, memory.size - offset);
+            crc = crc32_combine(crc, partial[i], size);
+        }
+
+        return crc;
+    }
+
+    const char* crc32_kernel()
+    {
+        return getKernel().name;
+    }
+
+} // namespace fastcrc
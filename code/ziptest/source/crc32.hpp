@@ -0,0 +1,67 @@
+/*
+    MANGO Multimedia Development Platform
+    Copyright (C) 2012-2025 Twilight Finland 3D Oy Ltd. All rights reserved.
+*/
+#pragma once
+
+#include <mango/mango.hpp>
+
+namespace fastcrc
+{
+    using mango::u32;
+    using mango::u64;
+    using mango::ConstMemory;
+
+    // CRC32 with the ZIP (ISO-HDLC) polynomial. The kernel is selected at first use:
+    // PCLMULQDQ folding on x86 (256 bit VPCLMULQDQ when available), CRC32 instructions
+    // on ARMv8 and mango::crc32() otherwise.
+    u32 crc32(u32 crc, ConstMemory memory);
+
+    // crc0 = crc32(A), crc1 = crc32(B), length1 = sizeof(B)  ->  crc32(A + B)
+    u32 crc32_combine(u32 crc0, u32 crc1, u64 length1);
+
+    // Compute blocks of the buffer on the thread pool and combine the partial results.
+    u32 crc32_parallel(u32 crc, ConstMemory memory, size_t blocksize = 1024 * 1024);
+
+    // name of the selected kernel
+    const char* crc32_kernel();
+
+    // Incremental CRC32 for stages which produce the data in pieces; either update() with
+    // the data as it is emitted or append() segments which were computed independently.
+    class Crc32
+    {
+    protected:
+        u32 m_crc;
+        u64 m_size;
+
+    public:
+        Crc32(u32 crc = 0)
+            : m_crc(crc)
+            , m_size(0)
+        {
+        }
+
+        void update(ConstMemory memory)
+        {
+            m_crc = fastcrc::crc32(m_crc, memory);
+            m_size += memory.size;
+        }
+
+        void append(u32 crc, u64 length)
+        {
+            m_crc = crc32_combine(m_crc, crc, length);
+            m_size += length;
+        }
+
+        u32 value() const
+        {
+            return m_crc;
+        }
+
+        u64 size() const
+        {
+            return m_size;
+        }
+    };
+
+} // namespace fastcrc
@@ -0,0 +1,259 @@
+/*
+    MANGO Multimedia Development Platform
+    Copyright (C) 2012-2025 Twilight Finland 3D Oy Ltd. All rights reserved.
+*/
+#include "prefetch.hpp"
+
+namespace prefetch
+{
+    using namespace mango;
+
+    Cache::Cache(const Path& path, size_t budget)
+        : m_path(path)
+        , m_budget(budget)
+    {
+    }
+
+    Cache::~Cache()
+    {
+        m_queue.cancel();
+        m_queue.wait();
+
+        // cancelled requests never complete; their callbacks are told that the load failed
+        for (auto& it : m_entries)
+        {
+            for (auto& callback : it.second.callbacks)
+            {
+                callback(it.first, Data());
+            }
+        }
+    }
+
+    std::shared_future<Data> Cache::prefetch(const std::string& filename)
+    {
+        return request(filename, Callback());
+    }
+
+    void Cache::prefetch(const std::string& filename, Callback callback)
+    {
+        request(filename, std::move(callback));
+    }
+
+    Data Cache::get(const std::string& filename)
+    {
+        std::shared_future<Data> future;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            auto it = m_entries.find(filename);
+            if (it != m_entries.end())
+            {
+                touch(it->second);
+                future = it->second.future;
+            }
+        }
+
+        if (future.valid())
+        {
+            // blocks only while the worker is still decompressing
+            return future.get();
+        }
+
+        // not requested: load on the calling thread
+        std::promise<Data> promise;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            auto it = m_entries.find(filename);
+            if (it != m_entries.end())
+            {
+                // requested by another thread in the meantime
+                future = it->second.future;
+            }
+            else
+            {
+                m_entries[filename].future = promise.get_future().share();
+            }
+        }
+
+        if (future.valid())
+        {
+            return future.get();
+        }
+
+        Data data;
+
+        try
+        {
+            data = std::make_shared<const File>(m_path, filename);
+            promise.set_value(data);
+        }
+        catch (...)
+        {
+            promise.set_exception(std::current_exception());
+            complete(filename, data);
+            throw;
+        }
+
+        complete(filename, data);
+        return data;
+    }
+
+    Data Cache::find(const std::string& filename)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        auto it = m_entries.find(filename);
+        if (it == m_entries.end() || !it->second.ready)
+        {
+            return Data();
+        }
+
+        touch(it->second);
+        return it->second.future.get();
+    }
+
+    size_t Cache::bytes()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_bytes;
+    }
+
+    void Cache::clear()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        // pending entries stay so that their completion finds them
+        for (auto it = m_entries.begin(); it != m_entries.end(); )
+        {
+            if (it->second.ready)
+                it = m_entries.erase(it);
+            else
+                ++it;
+        }
+
+        m_lru.clear();
+        m_bytes = 0;
+    }
+
+    std::shared_future<Data> Cache::request(const std::string& filename, Callback callback)
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+
+        auto it = m_entries.find(filename);
+        if (it != m_entries.end())
+        {
+            Entry& entry = it->second;
+            touch(entry);
+
+            std::shared_future<Data> future = entry.future;
+
+            if (callback)
+            {
+                if (entry.ready)
+                {
+                    lock.unlock();
+                    callback(filename, future.get());
+                }
+                else
+                {
+                    entry.callbacks.push_back(std::move(callback));
+                }
+            }
+
+            return future;
+        }
+
+        auto promise = std::make_shared<std::promise<Data>>();
+        std::shared_future<Data> future = promise->get_future().share();
+
+        Entry& entry = m_entries[filename];
+        entry.future = future;
+        if (callback)
+        {
+            entry.callbacks.push_back(std::move(callback));
+        }
+
+        lock.unlock();
+
+        m_queue.enqueue([this, filename, promise]
+        {
+            Data data;
+
+            try
+            {
+                data = std::make_shared<const File>(m_path, filename);
+                promise->set_value(data);
+            }
+            catch (...)
+            {
+                promise->set_exception(std::current_exception());
+            }
+
+            complete(filename, data);
+        });
+
+        return future;
+    }
+
+    void Cache::complete(const std::string& filename, const Data& data)
+    {
+        std::vector<Callback> callbacks;
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+
+            auto it = m_entries.find(filename);
+            if (it != m_entries.end())
+            {
+                Entry& entry = it->second;
+                std::swap(callbacks, entry.callbacks);
+
+                size_t bytes = data ? size_t(data->size()) : 0;
+
+                if (!data || bytes > m_budget)
+                {
+                    // failed or too large to be cached; the future still delivers the result
+                    m_entries.erase(it);
+                }
+                else
+                {
+                    entry.bytes = bytes;
+                    entry.ready = true;
+                    m_lru.push_front(filename);
+                    entry.lru = m_lru.begin();
+                    m_bytes += bytes;
+
+                    evict();
+                }
+            }
+        }
+
+        for (auto& callback : callbacks)
+        {
+            callback(filename, data);
+        }
+    }
+
+    void Cache::touch(Entry& entry)
+    {
+        if (entry.ready)
+        {
+            m_lru.splice(m_lru.begin(), m_lru, entry.lru);
+        }
+    }
+
+    void Cache::evict()
+    {
+        while (m_bytes > m_budget && !m_lru.empty())
+        {
+            auto it = m_entries.find(m_lru.back());
+            m_bytes -= it->second.bytes;
+            m_entries.erase(it);
+            m_lru.pop_back();
+        }
+    }
+
+} // namespace prefetch
@@ -0,0 +1,75 @@
+/*
+    MANGO Multimedia Development Platform
+    Copyright (C) 2012-2025 Twilight Finland 3D Oy Ltd. All rights reserved.
+*/
+#pragma once
+
+#include <list>
+#include <future>
+#include <unordered_map>
+#include <mango/mango.hpp>
+
+namespace prefetch
+{
+    using mango::filesystem::Path;
+    using mango::filesystem::File;
+
+    // Decompressed entry; the memory stays valid while a reference is held even if the
+    // entry has been evicted from the cache.
+    using Data = std::shared_ptr<const File>;
+    using Callback = std::function<void(const std::string& filename, Data data)>;
+
+    // Reads and decompresses entries of a Path on the thread pool ahead of their use
+    // and keeps the most recently used ones within a byte budget. The Path must outlive
+    // the cache and is assumed to support concurrent File access.
+
+    class Cache
+    {
+    protected:
+        struct Entry
+        {
+            std::shared_future<Data> future;
+            std::vector<Callback> callbacks; // waiting for the pending request
+            std::list<std::string>::iterator lru;
+            size_t bytes = 0;
+            bool ready = false;
+        };
+
+        const Path& m_path;
+        size_t m_budget;
+        size_t m_bytes = 0;
+
+        std::mutex m_mutex;
+        std::unordered_map<std::string, Entry> m_entries;
+        std::list<std::string> m_lru; // front is most recently used, only ready entries
+
+        mango::ConcurrentQueue m_queue;
+
+        std::shared_future<Data> request(const std::string& filename, Callback callback);
+        void complete(const std::string& filename, const Data& data);
+        void touch(Entry& entry);
+        void evict();
+
+    public:
+        Cache(const Path& path, size_t budget);
+        ~Cache();
+
+        // queue the entry for decompression
+        std::shared_future<Data> prefetch(const std::string& filename);
+
+        // queue the entry; the callback is invoked by the thread which completes the load,
+        // or immediately when the entry is already cached. The data is null on failure and
+        // when the cache is destroyed before the load was started.
+        void prefetch(const std::string& filename, Callback callback);
+
+        // returns the entry, waiting for the prefetch or loading it on the calling thread
+        Data get(const std::string& filename);
+
+        // returns the entry only if it is ready, never blocks
+        Data find(const std::string& filename);
+
+        size_t bytes();
+        void clear();
+    };
+
+} // namespace prefetch
@@ -2,7 +2,13 @@
     MANGO Multimedia Development Platform
     Copyright (C) 2012-2025 Twilight Finland 3D Oy Ltd. All rights reserved.
 */
+#include <bzlib.h>
 #include <mango/mango.hpp>
+#include "crc32.hpp"
+#include "zipwriter.hpp"
+#include "rss.hpp"
+#include "bzip2mt.hpp"
+#include "prefetch.hpp"
 
 using namespace mango;
 using namespace mango::filesystem;
@@ -11,7 +17,7 @@ void test(const std::string& pathname, const std::string& filename, const std::s
 {
     Path path(pathname + "/", password);
     File file(path, filename);
-    u32 checksum = crc32(0, file);
+    u32 checksum = fastcrc::crc32_parallel(0, file);
 
     if (checksum == expected)
     {
@@ -23,16 +29,389 @@ void test(const std::string& pathname, const std::string& filename, const std::s
     }
 }
 
-int main()
+ConstMemory getRawEntry(ConstMemory archive, const std::string& filename, u16& method, u64& size);
+
+// Write an archive with every method and read it back through the mango zip reader;
+// the method recorded in the archive is checked so that a silent fallback to store
+// does not pass.
+void test_writer(const std::string& filename)
+{
+    struct Case
+    {
+        const char* name;
+        zip::Method method;
+        u16 method_id;
+    };
+
+    const Case cases [] =
+    {
+        { "store/mipsIV32.pdf",   zip::Method::AUTO, 0 }, // .pdf is stored
+        { "deflate/mipsIV32.bin", zip::Method::DEFLATE, 8 },
+        { "lzma/mipsIV32.bin",    zip::Method::LZMA, 14 },
+        { "zstd/mipsIV32.bin",    zip::Method::ZSTD, 93 },
+    };
+
+    Path source("../data/deflate.zip/");
+    File file(source, "mipsIV32.pdf");
+
+    {
+        OutputFileStream stream(filename);
+        zip::Writer writer(stream);
+
+        for (const Case& c : cases)
+        {
+            writer.add(c.name, file, c.method);
+        }
+
+        writer.close();
+    }
+
+    File archive(filename);
+    Path path(filename + "/");
+
+    for (const Case& c : cases)
+    {
+        u16 method = 0xffff;
+        u64 size = 0;
+        getRawEntry(archive, c.name, method, size);
+
+        File entry(path, c.name);
+        ConstMemory memory = entry;
+        u32 checksum = fastcrc::crc32_parallel(0, memory);
+
+        bool identical = memory.size == file.size() && !std::memcmp(memory.address, file.data(), memory.size);
+
+        if (method == c.method_id && checksum == 0x69dc3b95 && identical)
+        {
+            printLine("{:<24} : PASSED", c.name);
+        }
+        else
+        {
+            printLine("{:<24} : FAILED method: {} {:#x}", c.name, method, checksum);
+        }
+    }
+}
+
+// Locate the compressed data of an unencrypted entry in the archive.
+ConstMemory getRawEntry(ConstMemory archive, const std::string& filename, u16& method, u64& size)
+{
+    const u8* begin = archive.address;
+    const u8* end = archive.address + archive.size;
+
+    // end of central directory record; followed by a comment of up to 64 KB
+    const u8* p = end - 22;
+    while (p >= begin && littleEndian::uload32(p) != 0x06054b50)
+    {
+        if (end - p > 22 + 0xffff)
+            return ConstMemory();
+        --p;
+    }
+
+    if (p < begin)
+        return ConstMemory();
+
+    u32 count = littleEndian::uload16(p + 10);
+    p = begin + littleEndian::uload32(p + 16);
+
+    for (u32 i = 0; i < count && p + 46 <= end; ++i)
+    {
+        if (littleEndian::uload32(p) != 0x02014b50)
+            break;
+
+        u16 flags = littleEndian::uload16(p + 8);
+        u16 compression = littleEndian::uload16(p + 10);
+        u32 compressed_size = littleEndian::uload32(p + 20);
+        u32 uncompressed_size = littleEndian::uload32(p + 24);
+        u16 name_length = littleEndian::uload16(p + 28);
+        u16 extra_length = littleEndian::uload16(p + 30);
+        u16 comment_length = littleEndian::uload16(p + 32);
+        u32 offset = littleEndian::uload32(p + 42);
+
+        std::string name(reinterpret_cast<const char*>(p + 46), name_length);
+
+        if (name == filename && !(flags & 1))
+        {
+            const u8* local = begin + offset;
+            u16 local_name_length = littleEndian::uload16(local + 26);
+            u16 local_extra_length = littleEndian::uload16(local + 28);
+
+            method = compression;
+            size = uncompressed_size;
+            return ConstMemory(local + 30 + local_name_length + local_extra_length, compressed_size);
+        }
+
+        p += 46 + name_length + extra_length + comment_length;
+    }
+
+    return ConstMemory();
+}
+
+// Decode the same raw bzip2 stream with libbzip2 and with the parallel decoder.
+void test_bzip2mt(const std::string& name, ConstMemory compressed, u64 size, u32 expected)
+{
+    Buffer buffer(size);
+
+    u64 time0 = Time::us();
+
+    unsigned int length = unsigned(size);
+    int result = BZ2_bzBuffToBuffDecompress(reinterpret_cast<char*>(buffer.data()), &length,
+        const_cast<char*>(reinterpret_cast<const char*>(compressed.address)), unsigned(compressed.size), 0, 0);
+
+    u64 time1 = Time::us();
+
+    u32 checksum0 = result == BZ_OK ? fastcrc::crc32_parallel(0, ConstMemory(buffer.data(), length)) : 0;
+    std::memset(buffer.data(), 0, size_t(size));
+
+    u64 time2 = Time::us();
+
+    CompressionStatus status = bzip2mt::decompress(buffer, compressed);
+
+    u64 time3 = Time::us();
+
+    u32 checksum1 = status ? fastcrc::crc32_parallel(0, ConstMemory(buffer.data(), status.size)) : 0;
+
+    if (checksum0 == expected && status && status.size == size && checksum1 == expected)
+    {
+        printLine("{:<24} : PASSED (serial: {} us, parallel: {} us)", name, time1 - time0, time3 - time2);
+    }
+    else
+    {
+        printLine("{:<24} : FAILED {:#x} {:#x}", name, checksum0, checksum1);
+    }
+}
+
+// The entry in the archive is a single block stream, which takes the serial fallback.
+void test_bzip2mt_archive(const std::string& pathname, const std::string& filename, u32 expected)
+{
+    File archive(pathname);
+
+    u16 method = 0;
+    u64 size = 0;
+    ConstMemory compressed = getRawEntry(archive, filename, method, size);
+
+    if (!compressed.address || method != 12)
+    {
+        printLine("{:<24} : FAILED (no bzip2 entry)", pathname);
+        return;
+    }
+
+    test_bzip2mt(pathname, compressed, size, expected);
+}
+
+// Compress with 100 KB blocks so that the stream has many blocks to decode in parallel.
+void test_bzip2mt_blocks(const std::string& pathname, const std::string& filename, u32 expected)
+{
+    Path path(pathname + "/");
+    File file(path, filename);
+    ConstMemory memory = file;
+
+    std::vector<u8> compressed(memory.size + memory.size / 100 + 600);
+    unsigned int length = unsigned(compressed.size());
+
+    int result = BZ2_bzBuffToBuffCompress(reinterpret_cast<char*>(compressed.data()), &length,
+        const_cast<char*>(reinterpret_cast<const char*>(memory.address)), unsigned(memory.size), 1, 0, 0);
+
+    if (result != BZ_OK)
+    {
+        printLine("{:<24} : FAILED (bzip2 compression)", "bzip2 blocks");
+        return;
+    }
+
+    test_bzip2mt("bzip2 blocks", ConstMemory(compressed.data(), length), memory.size, expected);
+}
+
+void test_prefetch(const std::string& pathname, const std::string& filename, u32 expected)
+{
+    Path path(pathname + "/");
+    prefetch::Cache cache(path, 16 * 1024 * 1024);
+
+    std::promise<u32> callback_promise;
+    std::future<u32> callback_future = callback_promise.get_future();
+
+    u64 time0 = Time::us();
+
+    auto future = cache.prefetch(filename);
+    cache.prefetch(filename, [&callback_promise] (const std::string& name, prefetch::Data data)
+    {
+        callback_promise.set_value(data ? fastcrc::crc32(0, *data) : 0);
+    });
+
+    u64 time1 = Time::us();
+
+    // the main thread would be doing something else here
+    prefetch::Data data = future.get();
+    u32 checksum = fastcrc::crc32(0, *data);
+
+    u64 time2 = Time::us();
+
+    // cached: must not block
+    bool cached = cache.find(filename) == data;
+
+    // the callback runs on the worker after the future is ready
+    u32 callback_checksum = 0;
+    if (callback_future.wait_for(std::chrono::seconds(10)) == std::future_status::ready)
+    {
+        callback_checksum = callback_future.get();
+    }
+
+    if (checksum == expected && callback_checksum == expected && cached)
+    {
+        printLine("{:<24} : PASSED (queue: {} us, wait: {} us)", pathname, time1 - time0, time2 - time1);
+    }
+    else
+    {
+        printLine("{:<24} : FAILED {:#x}", pathname, checksum);
+    }
+}
+
+struct TestCase
+{
+    const char* method;
+    const char* pathname;
+    const char* filename;
+    const char* password;
+    u32 expected;
+};
+
+const TestCase g_tests [] =
+{
+    { "deflate",      "../data/deflate.zip", "mipsIV32.pdf", "", 0x69dc3b95 },
+    { "bzip2",        "../data/bzip2.zip", "mipsIV32.pdf", "", 0x69dc3b95 },
+    { "lzma",         "../data/lzma.zip", "mipsIV32.pdf", "", 0x69dc3b95 },
+    { "ppmd",         "../data/ppmd.zip", "mipsIV32.pdf", "", 0x69dc3b95 },
+    { "bzip2+crypto", "../data/bzip2_crypto.zip", "station.jpg", "rapa1234", 0xafce3b8d },
+    { "bzip2+aes256", "../data/bzip2_aes256.zip", "station.jpg", "rapa1234", 0xafce3b8d },
+    { "aes128",       "../data/aes128.zip", "mipsIV32.pdf", "secret1234", 0x69dc3b95 },
+    { "aes192",       "../data/aes192.zip", "mipsIV32.pdf", "secret1234", 0x69dc3b95 },
+    { "aes256",       "../data/aes256.zip", "mipsIV32.pdf", "secret1234", 0x69dc3b95 },
+    { "deflate64",    "../data/deflate64.zip", "mipsIV32.pdf", "", 0x69dc3b95 },
+};
+
+u64 median(std::vector<u64> values)
+{
+    std::sort(values.begin(), values.end());
+    size_t n = values.size() / 2;
+    return (values.size() & 1) ? values[n] : (values[n - 1] + values[n]) / 2;
+}
+
+double getMBps(u64 bytes, u64 us)
+{
+    return us ? double(bytes) / double(us) : 0.0;
+}
+
+void bench(const TestCase& test, int repeat, bool json)
 {
-    test("../data/deflate.zip", "mipsIV32.pdf", "", 0x69dc3b95);
-    test("../data/bzip2.zip", "mipsIV32.pdf", "", 0x69dc3b95);
-    test("../data/lzma.zip", "mipsIV32.pdf", "", 0x69dc3b95);
-    test("../data/ppmd.zip", "mipsIV32.pdf", "", 0x69dc3b95);
-    test("../data/bzip2_crypto.zip", "station.jpg", "rapa1234", 0xafce3b8d);
-    test("../data/bzip2_aes256.zip", "station.jpg", "rapa1234", 0xafce3b8d);
-    test("../data/aes128.zip", "mipsIV32.pdf", "secret1234", 0x69dc3b95);
-    test("../data/aes192.zip", "mipsIV32.pdf", "secret1234", 0x69dc3b95);
-    test("../data/aes256.zip", "mipsIV32.pdf", "secret1234", 0x69dc3b95);
-    test("../data/deflate64.zip", "mipsIV32.pdf", "", 0x69dc3b95);
+    std::vector<u64> open_time;
+    std::vector<u64> extract_time;
+    std::vector<u64> crc_time;
+
+    u64 size = 0;
+    bool passed = true;
+
+    resetPeakRSS();
+
+    for (int i = 0; i < repeat; ++i)
+    {
+        u64 time0 = Time::us();
+
+        // parses the central directory
+        Path path(std::string(test.pathname) + "/", test.password);
+
+        u64 time1 = Time::us();
+
+        // decrypts and decompresses the entry
+        File file(path, test.filename);
+
+        u64 time2 = Time::us();
+
+        u32 checksum = fastcrc::crc32_parallel(0, file);
+
+        u64 time3 = Time::us();
+
+        open_time.push_back(time1 - time0);
+        extract_time.push_back(time2 - time1);
+        crc_time.push_back(time3 - time2);
+
+        size = file.size();
+        passed = passed && (checksum == test.expected);
+    }
+
+    u64 peak = getPeakRSS();
+
+    u64 open_us = median(open_time);
+    u64 extract_us = median(extract_time);
+    u64 crc_us = median(crc_time);
+
+    const char* status = passed ? "PASSED" : "FAILED";
+
+    if (json)
+    {
+        printLine("{{ \"method\": \"{}\", \"archive\": \"{}\", \"size\": {}, \"repeat\": {}, "
+                  "\"open_us\": {}, \"extract_us\": {}, \"extract_mbps\": {:.1f}, \"crc_mbps\": {:.1f}, "
+                  "\"peak_rss\": {}, \"status\": \"{}\" }}",
+            test.method, test.pathname, size, repeat,
+            open_us, extract_us, getMBps(size, extract_us), getMBps(size, crc_us),
+            peak, status);
+    }
+    else
+    {
+        printLine("{:<14} {:>9} {:>11} {:>10.1f} {:>10.1f} {:>10} {}",
+            test.method, open_us, extract_us, getMBps(size, extract_us), getMBps(size, crc_us),
+            peak / 1024, status);
+    }
+}
+
+int main(int argc, const char* argv[])
+{
+    int repeat = 0;
+    bool json = false;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+
+        if (arg == "--bench" && i + 1 < argc)
+        {
+            repeat = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--json")
+        {
+            json = true;
+        }
+        else
+        {
+            printLine("usage: ziptest [--bench <repeat>] [--json]");
+            return 1;
+        }
+    }
+
+    if (repeat > 0)
+    {
+        if (!json)
+        {
+            printLine("crc32: {}, repeat: {}, median times", fastcrc::crc32_kernel(), repeat);
+            printLine("----------------------------------------------------------------------------");
+            printLine("method          open(us) extract(us)       MB/s  crc(MB/s)   peak(KB)");
+            printLine("----------------------------------------------------------------------------");
+        }
+
+        for (const TestCase& t : g_tests)
+        {
+            bench(t, repeat, json);
+        }
+
+        return 0;
+    }
+
+    printLine("crc32: {}", fastcrc::crc32_kernel());
+
+    for (const TestCase& t : g_tests)
+    {
+        test(t.pathname, t.filename, t.password, t.expected);
+    }
+
+    test_writer("ziptest_output.zip");
+    test_bzip2mt_archive("../data/bzip2.zip", "mipsIV32.pdf", 0x69dc3b95);
+    test_bzip2mt_blocks("../data/deflate.zip", "mipsIV32.pdf", 0x69dc3b95);
+    test_prefetch("../data/lzma.zip", "mipsIV32.pdf", 0x69dc3b95);
 }
@@ -0,0 +1,400 @@
+/*
+    MANGO Multimedia Development Platform
+    Copyright (C) 2012-2025 Twilight Finland 3D Oy Ltd. All rights reserved.
+*/
+#include <ctime>
+#include "zipwriter.hpp"
+#include "crc32.hpp"
+
+namespace
+{
+    using namespace mango;
+
+    enum : u32
+    {
+        LOCAL_HEADER_SIGNATURE   = 0x04034b50,
+        CENTRAL_HEADER_SIGNATURE = 0x02014b50,
+        END_HEADER_SIGNATURE     = 0x06054b50,
+    };
+
+    enum : u16
+    {
+        METHOD_STORE   = 0,
+        METHOD_DEFLATE = 8,
+        METHOD_LZMA    = 14,
+        METHOD_ZSTD    = 93,
+    };
+
+    enum : u16
+    {
+        FLAG_UTF8 = 0x0800,
+    };
+
+    u16 getVersionNeeded(u16 method)
+    {
+        switch (method)
+        {
+            case METHOD_LZMA: return 63;
+            case METHOD_ZSTD: return 63;
+            default: return 20;
+        }
+    }
+
+    void getDosTime(u16& time, u16& date)
+    {
+        std::time_t now = std::time(nullptr);
+        std::tm* t = std::localtime(&now);
+        time = u16((t->tm_hour << 11) | (t->tm_min << 5) | (t->tm_sec >> 1));
+        date = u16(((t->tm_year - 80) << 9) | ((t->tm_mon + 1) << 5) | t->tm_mday);
+    }
+
+    // ZIP method 14 stores the LZMA properties in front of the raw LZMA stream:
+    //
+    //   u8  major, minor  LZMA SDK version
+    //   u16 size          size of the properties (5)
+    //   u8  properties    lc/lp/pb byte and u32 dictionary size
+    //   ...               raw stream, the decoder stops at the uncompressed size
+    //
+    // mango::lzma::compress() produces the properties followed by the raw stream
+    // without an end marker, so general purpose flag bit 1 (EOS marker) stays clear.
+
+    constexpr size_t LZMA_HEADER_SIZE = 4;
+    constexpr size_t LZMA_PROPS_SIZE = 5;
+
+    size_t compressLZMA(std::vector<u8>& output, ConstMemory memory, int level)
+    {
+        output.resize(LZMA_HEADER_SIZE + lzma::bound(memory.size));
+
+        Memory dest(output.data() + LZMA_HEADER_SIZE, output.size() - LZMA_HEADER_SIZE);
+        CompressionStatus status = lzma::compress(dest, memory, level);
+        if (!status || status.size <= LZMA_PROPS_SIZE)
+        {
+            return 0;
+        }
+
+        // check that the stream begins with valid properties before declaring them
+        const u8* props = dest.address;
+        u32 dictionary = littleEndian::uload32(props + 1);
+        if (props[0] >= 9 * 5 * 5 || dictionary < 4096)
+        {
+            MANGO_EXCEPTION("[zip::Writer] The LZMA stream has no properties header.");
+        }
+
+        output[0] = 19; // SDK 19.00
+        output[1] = 0;
+        littleEndian::ustore16(output.data() + 2, u16(LZMA_PROPS_SIZE));
+
+        return LZMA_HEADER_SIZE + status.size;
+    }
+
+    const char* g_compressed_extensions [] =
+    {
+        "jpg", "jpeg", "png", "gif", "webp", "jxl", "heic", "avif", "ktx2", "basis",
+        "pdf", "zip", "7z", "rar", "gz", "tgz", "bz2", "xz", "zst", "lz4",
+        "mp3", "ogg", "opus", "aac", "flac", "mp4", "m4a", "mkv", "webm", "mov",
+    };
+
+} // namespace
+
+namespace zip
+{
+    using namespace mango;
+
+    bool isCompressed(const std::string& name, ConstMemory memory)
+    {
+        size_t n = name.find_last_of('.');
+        if (n != std::string::npos)
+        {
+            std::string extension = name.substr(n + 1);
+            std::transform(extension.begin(), extension.end(), extension.begin(),
+                [] (unsigned char c) { return char(std::tolower(c)); });
+
+            for (const char* ext : g_compressed_extensions)
+            {
+                if (extension == ext)
+                    return true;
+            }
+        }
+
+        // unknown content: a quick lz4 pass over a sample tells if there is redundancy left
+        constexpr size_t sample_size = 64 * 1024;
+        if (memory.size >= sample_size * 2)
+        {
+            ConstMemory sample(memory.address + memory.size / 2 - sample_size / 2, sample_size);
+            Buffer temp(lz4::bound(sample.size));
+            size_t size = lz4::compress(temp, sample, 1);
+            return size > sample.size * 31 / 32;
+        }
+
+        return false;
+    }
+
+    // ----------------------------------------------------------------------------
+    // Writer
+    // ----------------------------------------------------------------------------
+
+    Writer::Writer(Stream& stream, Method method, int level, size_t max_pending)
+        : m_stream(stream)
+        , m_default(method == Method::AUTO ? Method::DEFLATE : method)
+        , m_level(level)
+        , m_max_pending(std::max(max_pending, size_t(1)))
+    {
+        getDosTime(m_time, m_date);
+    }
+
+    Writer::~Writer()
+    {
+        if (!m_closed)
+        {
+            m_queue.cancel();
+            m_queue.wait();
+        }
+    }
+
+    void Writer::add(const std::string& name, ConstMemory memory, Method method)
+    {
+        auto entry = std::make_unique<Entry>();
+        entry->name = name;
+        entry->method = method;
+        entry->memory = memory;
+        enqueue(std::move(entry));
+    }
+
+    void Writer::addFile(const std::string& name, const std::string& filename, Method method)
+    {
+        auto entry = std::make_unique<Entry>();
+        entry->name = name;
+        entry->method = method;
+        entry->filename = filename;
+        enqueue(std::move(entry));
+    }
+
+    void Writer::enqueue(std::unique_ptr<Entry> entry)
+    {
+        if (m_closed)
+        {
+            MANGO_EXCEPTION("[zip::Writer] Archive is already closed.");
+        }
+
+        if (m_entries.size() >= 0xffff)
+        {
+            MANGO_EXCEPTION("[zip::Writer] Too many entries (ZIP64 is not supported).");
+        }
+
+        Entry* ptr = entry.get();
+        m_entries.push_back(std::move(entry));
+
+        m_queue.enqueue([this, ptr]
+        {
+            try
+            {
+                compress(*ptr);
+            }
+            catch (...)
+            {
+                // reported by flush() when the entry is written
+                ptr->error = std::current_exception();
+            }
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ptr->ready = true;
+            m_condition.notify_all();
+        });
+
+        // write what is already finished and throttle when too many results are buffered
+        flush(false);
+    }
+
+    void Writer::compress(Entry& entry)
+    {
+        std::unique_ptr<filesystem::File> file;
+
+        ConstMemory memory = entry.memory;
+        if (!entry.filename.empty())
+        {
+            file = std::make_unique<filesystem::File>(entry.filename);
+            memory = *file;
+        }
+
+        if (memory.size > 0xffffffff)
+        {
+            MANGO_EXCEPTION("[zip::Writer] Entry is too large (ZIP64 is not supported).");
+        }
+
+        entry.size = memory.size;
+        entry.crc = fastcrc::crc32(0, memory);
+
+        Method method = entry.method;
+        if (method == Method::AUTO)
+        {
+            method = isCompressed(entry.name, memory) ? Method::STORE : m_default;
+        }
+
+        if (memory.size == 0)
+        {
+            method = Method::STORE;
+        }
+
+        size_t size = 0;
+
+        switch (method)
+        {
+            case Method::DEFLATE:
+            {
+                entry.compressed.resize(deflate::bound(memory.size));
+                Memory dest(entry.compressed.data(), entry.compressed.size());
+                size = deflate::compress(dest, memory, m_level);
+                entry.method_id = METHOD_DEFLATE;
+                break;
+            }
+
+            case Method::LZMA:
+            {
+                size = compressLZMA(entry.compressed, memory, m_level);
+                entry.method_id = METHOD_LZMA;
+                break;
+            }
+
+            case Method::ZSTD:
+            {
+                entry.compressed.resize(zstd::bound(memory.size));
+                Memory dest(entry.compressed.data(), entry.compressed.size());
+                size = zstd::compress(dest, memory, m_level);
+                entry.method_id = METHOD_ZSTD;
+                break;
+            }
+
+            default:
+                break;
+        }
+
+        if (size == 0 || size >= memory.size)
+        {
+            // not compressible (or the compressor failed): store
+            entry.compressed.assign(memory.address, memory.address + memory.size);
+            size = memory.size;
+            entry.method_id = METHOD_STORE;
+        }
+
+        entry.compressed.resize(size);
+        entry.compressed_size = size;
+    }
+
+    void Writer::flush(bool wait)
+    {
+        while (m_written < m_entries.size())
+        {
+            Entry& entry = *m_entries[m_written];
+
+            size_t pending = m_entries.size() - m_written;
+            bool block = wait || pending > m_max_pending;
+
+            if (!entry.ready)
+            {
+                if (!block)
+                    break;
+
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_condition.wait(lock, [&entry] { return entry.ready.load(); });
+            }
+
+            if (entry.error)
+            {
+                std::rethrow_exception(entry.error);
+            }
+
+            entry.offset = m_stream.offset();
+            if (entry.offset + entry.compressed_size > 0xffffffff)
+            {
+                MANGO_EXCEPTION("[zip::Writer] Archive is too large (ZIP64 is not supported).");
+            }
+
+            writeLocalHeader(entry);
+            m_stream.write(entry.compressed.data(), entry.compressed.size());
+
+            // release the compressed data; only the directory information is kept
+            std::vector<u8>().swap(entry.compressed);
+
+            ++m_written;
+        }
+    }
+
+    void Writer::writeLocalHeader(Entry& entry)
+    {
+        LittleEndianStream s = m_stream;
+
+        s.write32(LOCAL_HEADER_SIGNATURE);
+        s.write16(getVersionNeeded(entry.method_id));
+        s.write16(FLAG_UTF8);
+        s.write16(entry.method_id);
+        s.write16(m_time);
+        s.write16(m_date);
+        s.write32(entry.crc);
+        s.write32(u32(entry.compressed_size));
+        s.write32(u32(entry.size));
+        s.write16(u16(entry.name.length()));
+        s.write16(0); // extra field length
+        s.write(entry.name.data(), entry.name.length());
+    }
+
+    void Writer::writeCentralDirectory()
+    {
+        LittleEndianStream s = m_stream;
+
+        u64 start = m_stream.offset();
+
+        for (auto& ptr : m_entries)
+        {
+            const Entry& entry = *ptr;
+
+            s.write32(CENTRAL_HEADER_SIGNATURE);
+            s.write16(63); // version made by: MS-DOS, 6.3
+            s.write16(getVersionNeeded(entry.method_id));
+            s.write16(FLAG_UTF8);
+            s.write16(entry.method_id);
+            s.write16(m_time);
+            s.write16(m_date);
+            s.write32(entry.crc);
+            s.write32(u32(entry.compressed_size));
+            s.write32(u32(entry.size));
+            s.write16(u16(entry.name.length()));
+            s.write16(0); // extra field length
+            s.write16(0); // comment length
+            s.write16(0); // disk number
+            s.write16(0); // internal attributes
+            s.write32(0); // external attributes
+            s.write32(u32(entry.offset));
+            s.write(entry.name.data(), entry.name.length());
+        }
+
+        u64 size = m_stream.offset() - start;
+        if (start > 0xffffffff || size > 0xffffffff)
+        {
+            MANGO_EXCEPTION("[zip::Writer] Archive is too large (ZIP64 is not supported).");
+        }
+
+        u16 count = u16(m_entries.size());
+
+        s.write32(END_HEADER_SIGNATURE);
+        s.write16(0); // disk number
+        s.write16(0); // disk with the central directory
+        s.write16(count);
+        s.write16(count);
+        s.write32(u32(size));
+        s.write32(u32(start));
+        s.write16(0); // comment length
+    }
+
+    void Writer::close()
+    {
+        if (m_closed)
+            return;
+
+        flush(true);
+        m_queue.wait();
+
+        writeCentralDirectory();
+        m_closed = true;
+    }
+
+} // namespace zip
@@ -0,0 +1,98 @@
+/*
+    MANGO Multimedia Development Platform
+    Copyright (C) 2012-2025 Twilight Finland 3D Oy Ltd. All rights reserved.
+*/
+#pragma once
+
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <exception>
+#include <mango/mango.hpp>
+
+namespace zip
+{
+    using mango::u8;
+    using mango::u16;
+    using mango::u32;
+    using mango::u64;
+    using mango::ConstMemory;
+    using mango::Stream;
+
+    enum class Method
+    {
+        AUTO,     // writer default, skipped for already compressed content
+        STORE,
+        DEFLATE,
+        LZMA,
+        ZSTD,
+    };
+
+    // Compresses the entries concurrently on the thread pool and writes them to the
+    // stream in the order they were added. The central directory is written by close().
+    // An exception thrown while compressing an entry is rethrown by the add() or close()
+    // call which reaches that entry; the archive is incomplete after that.
+    // ZIP64 is not supported; the archive is limited to 65535 entries and 4 GB.
+
+    class Writer
+    {
+    protected:
+        struct Entry
+        {
+            std::string name;
+            Method method;
+
+            // input, either memory owned by the caller or a file opened by the worker
+            ConstMemory memory;
+            std::string filename;
+
+            // result
+            std::vector<u8> compressed;
+            u16 method_id = 0;
+            u32 crc = 0;
+            u64 compressed_size = 0;
+            u64 size = 0;
+            u64 offset = 0;
+            std::exception_ptr error;
+            std::atomic<bool> ready { false };
+        };
+
+        Stream& m_stream;
+        Method m_default;
+        int m_level;
+        size_t m_max_pending;
+
+        u16 m_time;
+        u16 m_date;
+
+        std::vector<std::unique_ptr<Entry>> m_entries;
+        size_t m_written = 0;
+        bool m_closed = false;
+
+        std::mutex m_mutex;
+        std::condition_variable m_condition;
+        mango::ConcurrentQueue m_queue;
+
+        void enqueue(std::unique_ptr<Entry> entry);
+        void compress(Entry& entry);
+        void flush(bool wait);
+        void writeLocalHeader(Entry& entry);
+        void writeCentralDirectory();
+
+    public:
+        Writer(Stream& stream, Method method = Method::DEFLATE, int level = 6, size_t max_pending = 256);
+        ~Writer();
+
+        // The memory must remain valid until the entry has been written; close() guarantees that.
+        void add(const std::string& name, ConstMemory memory, Method method = Method::AUTO);
+
+        // The file is mapped and compressed on a worker thread.
+        void addFile(const std::string& name, const std::string& filename, Method method = Method::AUTO);
+
+        void close();
+    };
+
+    // true for content which does not benefit from another round of compression
+    bool isCompressed(const std::string& name, ConstMemory memory);
+
+} // namespace zip